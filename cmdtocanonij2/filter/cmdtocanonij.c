@@ -38,7 +38,6 @@
 #include <sys/wait.h>
 #include <ctype.h>
 #include <errno.h>
-#include <dlfcn.h>
 #include <time.h>
 
 //#include "./cnclinc/cncl.h"
@@ -46,6 +45,7 @@
 #include "./cnclinc/cnclcmdutils.h"
 
 #include "cnijutil.h"
+#include "cnijcncl.h"
 
 #if HAVE_CONFIG_H
 #include <config.h>
@@ -72,12 +72,12 @@ int g_signal_received = 0;
 
 static	char jobDesc[UUID_LEN + 1];
 
-static int (*GetProtocol)(char *, size_t);
-static int (*GETSTRINGWITHTAGFROMFILE)( const char* , const char* , int* , uint8_t** );
-static int (*ParseCapabilityResponsePrint_HostEnv)(void *, int);
-static int (*MakeCommand_StartJob3)(int, char *, char[], void *, long, long *);
-static int (*ParseCapabilityResponsePrint_DateTime)(void *, int);
-static int (*MakeCommand_SetJobConfiguration)(char[], char[], void *, long, long *);
+static CNCL_TYPE_GetProtocol	GetProtocol;
+static CNCL_TYPE_GetStringWithTagFromFile	GETSTRINGWITHTAGFROMFILE;
+static CNCL_TYPE_ParseCapabilityResponsePrint_HostEnv	ParseCapabilityResponsePrint_HostEnv;
+static CNCL_TYPE_MakeCommand_StartJob3	MakeCommand_StartJob3;
+static CNCL_TYPE_ParseCapabilityResponsePrint_DateTime	ParseCapabilityResponsePrint_DateTime;
+static CNCL_TYPE_MakeCommand_SetJobConfiguration	MakeCommand_SetJobConfiguration;
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -221,13 +221,11 @@ static int write_command(const char *command)
 
 
 			/* start1 */
-			void *libclss = NULL;
 			const char *p_ppd_name = getenv("PPD");
 
-			GetProtocol = NULL;
-			GetProtocol = dlsym(libclss, "CNCL_GetProtocol");
+			GetProtocol = CNCL_API( GetProtocol );
 
-			if(dlerror() != NULL){
+			if(GetProtocol == NULL){
 				goto onErr;
 			}
 
@@ -238,34 +236,35 @@ static int write_command(const char *command)
 				goto onErr;
 			}
 
-			int prot = CNCL_GetProtocol((char *)capability.deviceID, capability.deviceIDLength);
+			int prot = GetProtocol((char *)capability.deviceID, capability.deviceIDLength);
 
 			if( prot == 2 ){
 				uint8_t *xmlBuf = NULL;
 				int xmlBufSize = 0;
+				unsigned int cmdSize = 0;
 
-				GETSTRINGWITHTAGFROMFILE = dlsym( libclss, "CNCL_GetStringWithTagFromFile" );
-				if ( dlerror() != NULL ) {
+				GETSTRINGWITHTAGFROMFILE = CNCL_API( GetStringWithTagFromFile );
+				if ( GETSTRINGWITHTAGFROMFILE == NULL ) {
 					fprintf( stderr, "Error in CNCL_GetStringWithTagFromFile\n" );
 					goto onErr;
 				}
-				ParseCapabilityResponsePrint_HostEnv = dlsym( libclss, "CNCL_ParseCapabilityResponsePrint_HostEnv" );
-				if ( dlerror() != NULL ) {
+				ParseCapabilityResponsePrint_HostEnv = CNCL_API( ParseCapabilityResponsePrint_HostEnv );
+				if ( ParseCapabilityResponsePrint_HostEnv == NULL ) {
 					fprintf( stderr, "Load Error in CNCL_ParseCapabilityResponsePrint_HostEnv\n" );
 					goto onErr;
 				}
-				MakeCommand_StartJob3 = dlsym( libclss, "CNCL_MakeCommand_StartJob3" );
-				if ( dlerror() != NULL ) {
+				MakeCommand_StartJob3 = CNCL_API( MakeCommand_StartJob3 );
+				if ( MakeCommand_StartJob3 == NULL ) {
 					fprintf( stderr, "Load Error in CNCL_MakeCommand_StartJob3\n" );
 					goto onErr;
 				}
-				ParseCapabilityResponsePrint_DateTime = dlsym( libclss, "CNCL_ParseCapabilityResponsePrint_DateTime" );
-				if ( dlerror() != NULL ) {
+				ParseCapabilityResponsePrint_DateTime = CNCL_API( ParseCapabilityResponsePrint_DateTime );
+				if ( ParseCapabilityResponsePrint_DateTime == NULL ) {
 					fprintf( stderr, "Load Error in CNCL_ParseCapabilityResponsePrint_DateTime\n" );
 					goto onErr;
 				}
-				MakeCommand_SetJobConfiguration = dlsym( libclss, "CNCL_MakeCommand_SetJobConfiguration" );
-				if ( dlerror() != NULL ) {
+				MakeCommand_SetJobConfiguration = CNCL_API( MakeCommand_SetJobConfiguration );
+				if ( MakeCommand_SetJobConfiguration == NULL ) {
 					fprintf( stderr, "Load Error in CNCL_MakeCommand_SetJobConfiguration\n" );
 					goto onErr;
 				}
@@ -273,7 +272,7 @@ static int write_command(const char *command)
 				xmlBuf = (uint8_t *) malloc(4096);
 				memset(xmlBuf, '\0', 4096);
 
-				xmlBufSize = GETSTRINGWITHTAGFROMFILE( p_ppd_name, CNCL_FILE_TAG_CAPABILITY, (int *)CNCL_DECODE_EXEC, &xmlBuf );
+				xmlBufSize = GETSTRINGWITHTAGFROMFILE( p_ppd_name, CNCL_FILE_TAG_CAPABILITY, CNCL_DECODE_EXEC, &xmlBuf );
 
 
 				// unsigned short hostEnv = 0;
@@ -286,7 +285,8 @@ static int write_command(const char *command)
 				/* Write StartJob Command */
 				int ret = 0;
 
-				ret = MakeCommand_StartJob3( hostEnv, jobDesc, jobID, command_buffer, CN_BUFSIZE, &writtenSize );
+				ret = MakeCommand_StartJob3( hostEnv, jobDesc, jobID, command_buffer, CN_BUFSIZE, &cmdSize );
+				writtenSize = cmdSize;
 
 				if ( ret != 0 ) {
 					fprintf( stderr, "Error in CNCL_GetPrintCommand\n" );
@@ -313,17 +313,14 @@ static int write_command(const char *command)
 
 					memset( command_buffer, 0x00, CN_BUFSIZE );
 
-					ret = MakeCommand_SetJobConfiguration( jobID, dateTime, command_buffer, CN_BUFSIZE, &writtenSize );
+					ret = MakeCommand_SetJobConfiguration( jobID, dateTime, command_buffer, CN_BUFSIZE, &cmdSize );
+					writtenSize = cmdSize;
 
 					/* WriteData */
 					if (write_buffer(command_buffer, writtenSize) != PROC_SUCCEEDED){
 						goto onErr;
 					}
 				}
-
-				if ( libclss != NULL ) {
-					dlclose( libclss );
-				}
 			}
 			else{
 				if (CNCL_GetPrintCommand((char*)command_buffer, CN_BUFSIZE, &writtenSize, jobID, CNCL_COMMAND_START1 ) != CNCL_OK) goto onErr;
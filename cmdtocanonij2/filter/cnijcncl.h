@@ -0,0 +1,93 @@
+/*
+ *  Canon Inkjet Printer Driver for Linux
+ *  Copyright CANON INC. 2001-2024
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * NOTE:
+ *  - As a special exception, this program is permissible to link with the
+ *    libraries released as the binary modules.
+ *  - If you write modifications of your own for these programs, it is your
+ *    choice whether to permit this exception to apply to your modifications.
+ *    If you do not wish that, delete this exception.
+*/
+
+#ifndef _CNIJCNCL_H_
+#define _CNIJCNCL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CNIJ_CNCL_LIBNAME	"libcnbpcnclapicom2.so"
+
+/* CNCL_FUNC( name, exported symbol, return type, arguments ) */
+#define CNIJ_CNCL_FUNCTIONS \
+	CNCL_FUNC( GetStringWithTagFromFile, "CNCL_GetStringWithTagFromFile", int, (const char*, const char*, int, uint8_t**) ) \
+	CNCL_FUNC( GetProtocol, "CNCL_GetProtocol", int, (char*, size_t) ) \
+	CNCL_FUNC( GetSetConfigurationCommand, "CNCL_GetSetConfigurationCommand", int, (void*, char*, long, void*, long, char*, long*) ) \
+	CNCL_FUNC( GetSendDataPWGRasterCommand, "CNCL_GetSendDataPWGRasterCommand", int, (char*, long, long, char*, long*) ) \
+	CNCL_FUNC( GetPrintCommand, "CNCL_GetPrintCommand", int, (char*, long, long*, char*, long) ) \
+	CNCL_FUNC( GetSetPageConfigurationCommand, "CNCL_GetSetPageConfigurationCommand", int, (const char*, unsigned short, void*, long, long*) ) \
+	CNCL_FUNC( MakeBJLSetTimeJob, "CNCL_MakeBJLSetTimeJob", int, (void*, size_t, size_t*) ) \
+	CNCL_FUNC( ParseCapabilityResponsePrint_HostEnv, "CNCL_ParseCapabilityResponsePrint_HostEnv", int, (void*, int) ) \
+	CNCL_FUNC( ParseCapabilityResponsePrint_DateTime, "CNCL_ParseCapabilityResponsePrint_DateTime", int, (void*, int) ) \
+	CNCL_FUNC( MakeCommand_StartJob3, "CNCL_MakeCommand_StartJob3", int, (int, char*, char[], void*, int, unsigned int*) ) \
+	CNCL_FUNC( MakeCommand_SetJobConfiguration, "CNCL_MakeCommand_SetJobConfiguration", int, (char[], char[], void*, int, unsigned int*) ) \
+	CNCL_FUNC( GetInfoResponse, "CNCL_GetInfoResponse", int, (char*, int, int*, char*, int**) ) \
+	CNCL_FUNC( GetStatus, "CNCL_GetStatus", int, (char*, int, int*, int*, char*) ) \
+	CNCL_FUNC( GetStatus2, "CNCL_GetStatus2", int, (char*, int, char*, int*, int*, char*, char*) ) \
+	CNCL_FUNC( GetStatus_Maintenance, "CNCL_GetStatus_Maintenance", int, (char*, int, char*, int*, int*, char*, char*) ) \
+	CNCL_FUNC( MakeCommand_CancelJob, "CNCL_MakeCommand_CancelJob", int, (char*, char*, unsigned int, unsigned int*) ) \
+	CNCL_FUNC( MakeCommand_CancelJob_Maintenance, "CNCL_MakeCommand_CancelJob_Maintenance", int, (char*, char*, unsigned int, unsigned int*) ) \
+	CNCL_FUNC( MakeCommand_GetStatusPrint, "CNCL_MakeCommand_GetStatusPrint", int, (char*, unsigned int, unsigned int*) ) \
+	CNCL_FUNC( MakeCommand_GetStatusMaintenance, "CNCL_MakeCommand_GetStatusMaintenance", int, (char*, unsigned int, unsigned int*) ) \
+	CNCL_FUNC( MakeCommand_TestPrint, "CNCL_MakeCommand_TestPrint", int, (char[], void*, int, long*) ) \
+	CNCL_FUNC( MakeCommand_Cleaning, "CNCL_MakeCommand_Cleaning", int, (char[], void*, int, long*) ) \
+	CNCL_FUNC( MakeCommand_AutoAlignment, "CNCL_MakeCommand_AutoAlignment", int, (char[], void*, int, long*) ) \
+	CNCL_FUNC( MakeCommand_StartJob3_Maintenance, "CNCL_MakeCommand_StartJob3_Maintenance", int, (int, char*, char[], void*, long, long*) ) \
+	CNCL_FUNC( MakeCommand_EndJob_Maintenance, "CNCL_MakeCommand_EndJob_Maintenance", int, (char[], void*, long, long*) ) \
+	CNCL_FUNC( MakeCommand_SetJobConfiguration_Maintenance, "CLSS_MakeCommand_SetJobConfiguration_Maintenance", int, (char[], char[], void*, int, long*) ) \
+	CNCL_FUNC( ParseCapabilityResponseMaintenance_HostEnv, "CNCL_ParseCapabilityResponseMaintenance_HostEnv", int, (void*, int) ) \
+	CNCL_FUNC( ParseCapabilityResponseMaintenance_DateTime, "CNCL_ParseCapabilityResponseMaintenance_DateTime", int, (void*, int) )
+
+enum {
+#define CNCL_FUNC( name, symbol, ret, args )	CNCL_ID_##name,
+	CNIJ_CNCL_FUNCTIONS
+#undef CNCL_FUNC
+	CNCL_ID_COUNT
+};
+
+#define CNCL_FUNC( name, symbol, ret, args )	typedef ret (*CNCL_TYPE_##name) args;
+CNIJ_CNCL_FUNCTIONS
+#undef CNCL_FUNC
+
+/*
+ * The library is opened once per process, from libPath when CnclOpen
+ * is called before the first entry point is used, else by name.
+ * Returns 0 on success. Open and resolve are safe to call from any thread.
+ */
+int CnclOpen( const char *libPath );
+void *CnclResolve( int id );
+
+/* resolve ids[] up front, reporting every missing one; returns 0 when all are present */
+int CnclRequire( const int ids[], int count );
+
+/* stat of the loaded library file, to notice when it is replaced; returns 0 on success */
+struct stat;
+int CnclLibraryStat( struct stat *st );
+
+/* typed entry point, NULL (and reported once) when it cannot be resolved */
+#define CNCL_API( name )	((CNCL_TYPE_##name)CnclResolve( CNCL_ID_##name ))
+
+#endif
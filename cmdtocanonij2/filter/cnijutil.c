@@ -26,22 +26,13 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include <dlfcn.h>
 
 #include "cnijutil.h"
+#include "cnijcncl.h"
 
-#define CN_CNCL_LIB_PATH		("libcnbpcnclapi%s.so")
-#define CN_LIB_PATH_LEN 512
-#define CN_CNCL_LIBNAME "libcnbpcnclapicom2.so"
 #define CNCL_FILE_TAG_DEVICEID		"CNIJ-DEVCE-INFO"
 
 
-static int (*GetStringWithTagFromFile)(const char*, const char*, int, uint8_t**);
-// static int (*GetStringWithTagFromFile)(const char*, const char*, int*, uint8_t**);
-// static int (*CNCL_GetStringWithTagFromFile)(const char*, const char*, size_t, uint8_t**);
-
-
-
 int GetUUID( char *arg , char *uuid ){
 	int		ret = 0;
 	char	*cnt = NULL;
@@ -61,25 +52,10 @@ int GetUUID( char *arg , char *uuid ){
 
 int GetCapabilityFromPPDFile(const char *ppdFileName, CAPABILITY_DATA *_data)
 {
-	char libPathBuf[CN_LIB_PATH_LEN];
-	void *libclss = NULL;
-	char model_number[] = "com2";
-
-	// snprintf( libPathBuf, CN_LIB_PATH_LEN, "%s%s", optarg, CN_CNCL_LIBNAME );
-	snprintf( libPathBuf, CN_LIB_PATH_LEN - 1, CN_CNCL_LIB_PATH, model_number );
-	// snprintf( libPathBuf, CN_LIB_PATH_LEN, "%s", CN_CNCL_LIBNAME );
-
-	libclss = dlopen( libPathBuf, RTLD_LAZY );
-	if ( !libclss ) {
-		fprintf( stderr, "Error in dlopen\n" );
-		goto onErr;
-	}
-
-	GetStringWithTagFromFile = NULL;
-	GetStringWithTagFromFile = dlsym( libclss, "CNCL_GetStringWithTagFromFile" );
+	CNCL_TYPE_GetStringWithTagFromFile GetStringWithTagFromFile;
 
-	if ( dlerror() != NULL ) {
-		fprintf( stderr, "Error in CNCL_GetSetConfigurationCommand. API not Found.\n" );
+	/* the process wide CNCL handle, opened on first use */
+	if ( (GetStringWithTagFromFile = CNCL_API( GetStringWithTagFromFile )) == NULL ) {
 		goto onErr;
 	}
 
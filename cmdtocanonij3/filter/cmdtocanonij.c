@@ -38,7 +38,6 @@
 #include <sys/wait.h>
 #include <ctype.h>
 #include <errno.h>
-#include <dlfcn.h>
 #include <time.h>
 
 //#include "./cnclinc/cncl.h"
@@ -46,6 +45,8 @@
 #include "./cnclinc/cnclcmdutils.h"
 
 #include "cnijutil.h"
+#include "cnijcapcache.h"
+#include "cnijcncl.h"
 
 #if HAVE_CONFIG_H
 #include <config.h>
@@ -88,17 +89,15 @@
 
 int g_signal_received = 0;
 
-static	void	*_libclss = NULL;
-
-static	int		(*GetStringWithTagFromFile)( const char* , const char* , int* , uint8_t** );
-static	int		(*MakeCommand_mnt_TestPrint)(char[], void *, int, long *);
-static	int		(*MakeCommand_mnt_Cleaning)(char[], void *, int, long *);
-static  int		(*MakeCommand_mnt_AutoAlignment)(char[], void *, int, long *);
-static	int		(*MakeCommand_mnt_StartJob3)(int, char *, char[], void *, long, long *);
-static	int		(*MakeCommand_mnt_EndJob)(char[], void *, long, long *);
-static	int		(*ParseCapabilityResponseMaintenance_HostEnv)(void *, int);
-static	int		(*ParseCapabilityResponseMaintenance_DateTime)(void *, int);
-static 	int		(*MakeCommand_mnt_SetJobConfiguration)(char[], char[], void *, int, long *);
+static	CNCL_TYPE_GetStringWithTagFromFile	GetStringWithTagFromFile;
+static	CNCL_TYPE_MakeCommand_TestPrint	MakeCommand_mnt_TestPrint;
+static	CNCL_TYPE_MakeCommand_Cleaning	MakeCommand_mnt_Cleaning;
+static	CNCL_TYPE_MakeCommand_AutoAlignment	MakeCommand_mnt_AutoAlignment;
+static	CNCL_TYPE_MakeCommand_StartJob3_Maintenance	MakeCommand_mnt_StartJob3;
+static	CNCL_TYPE_MakeCommand_EndJob_Maintenance	MakeCommand_mnt_EndJob;
+static	CNCL_TYPE_ParseCapabilityResponseMaintenance_HostEnv	ParseCapabilityResponseMaintenance_HostEnv;
+static	CNCL_TYPE_ParseCapabilityResponseMaintenance_DateTime	ParseCapabilityResponseMaintenance_DateTime;
+static	CNCL_TYPE_MakeCommand_SetJobConfiguration_Maintenance	MakeCommand_mnt_SetJobConfiguration;
 
 
 
@@ -173,15 +172,15 @@ int MakeCommand_StartJob3( char *capXml, int capXmlSize, uint8_t *cmdBuf, long c
 	int hostEnv = 0;
 
 
-	ParseCapabilityResponseMaintenance_HostEnv = dlsym( _libclss, "CNCL_ParseCapabilityResponseMaintenance_HostEnv" );
-	if ( dlerror() != NULL ) {
+	ParseCapabilityResponseMaintenance_HostEnv = CNCL_API( ParseCapabilityResponseMaintenance_HostEnv );
+	if ( ParseCapabilityResponseMaintenance_HostEnv == NULL ) {
 		fprintf( stderr, "Load Error in CNCL_ParseCapabilityResponseMaintenance_HostEnv\n" );
 		goto error_exit;
 	}
 
-	MakeCommand_mnt_StartJob3 = dlsym( _libclss, "CNCL_MakeCommand_StartJob3_Maintenance" );
+	MakeCommand_mnt_StartJob3 = CNCL_API( MakeCommand_StartJob3_Maintenance );
 
-	if ( dlerror() != NULL ) {
+	if ( MakeCommand_mnt_StartJob3 == NULL ) {
 		fprintf( stderr, "Load Error in CNCL_MakeCommand_StartJob3\n" );
 		rtn = ERR_MAKE_COMMAND;
 		goto error_exit;
@@ -209,18 +208,18 @@ int MakeCommand_SetJobConfiguration( char *capXml, int capXmlSize, uint8_t *cmdB
 	// long writtenSize = 0;
 
 
-	ParseCapabilityResponseMaintenance_DateTime = dlsym( _libclss, "CNCL_ParseCapabilityResponseMaintenance_DateTime" );
+	ParseCapabilityResponseMaintenance_DateTime = CNCL_API( ParseCapabilityResponseMaintenance_DateTime );
 
-	if ( dlerror() != NULL ) {
+	if ( ParseCapabilityResponseMaintenance_DateTime == NULL ) {
 		fprintf( stderr, "Load Error in CNCL_ParseCapabilityResponseMaintenance_DateTime\n" );
 		rtn = ERR_MAKE_COMMAND;
 		goto error_exit;
 	}
 
 
-	MakeCommand_mnt_SetJobConfiguration = dlsym( _libclss, "CLSS_MakeCommand_SetJobConfiguration_Maintenance" );
+	MakeCommand_mnt_SetJobConfiguration = CNCL_API( MakeCommand_SetJobConfiguration_Maintenance );
 
-	if ( dlerror() != NULL ) {
+	if ( MakeCommand_mnt_SetJobConfiguration == NULL ) {
 		fprintf( stderr, "Load Error in CLSS_MakeCommand_SetJobConfiguration_Maintenance\n" );
 		rtn = ERR_MAKE_COMMAND;
 		goto error_exit;
@@ -265,9 +264,9 @@ int MakeCommand_EndJob( uint8_t *cmdBuf, long cmdSize, long *writtenSize ){
 	int rtn = PROC_FAILED;
 	// long writtenSize = 0;
 
-	MakeCommand_mnt_EndJob = dlsym( _libclss, "CNCL_MakeCommand_EndJob_Maintenance" );
+	MakeCommand_mnt_EndJob = CNCL_API( MakeCommand_EndJob_Maintenance );
 
-	if ( dlerror() != NULL ) {
+	if ( MakeCommand_mnt_EndJob == NULL ) {
 		fprintf( stderr, "Load Error in CNCL_MakeCommand_EndJob_Maintenance\n" );
 		rtn = ERR_MAKE_COMMAND;
 		goto error_exit;
@@ -293,9 +292,9 @@ int MakeCommand_TestPrint( uint8_t *cmdBuf, long cmdSize, long *writtenSize ){
 	// long writtenSize = 0;
 
 
-	MakeCommand_mnt_TestPrint = dlsym( _libclss, "CNCL_MakeCommand_TestPrint" );
+	MakeCommand_mnt_TestPrint = CNCL_API( MakeCommand_TestPrint );
 
-	if ( dlerror() != NULL ) {
+	if ( MakeCommand_mnt_TestPrint == NULL ) {
 		fprintf( stderr, "[cmdtocanonij3] Load Error in CNCL_MakeCommand_TestPrint\n" );
 		rtn = ERR_MAKE_COMMAND;
 		goto error_exit;
@@ -321,9 +320,9 @@ int MakeCommand_Cleaning( uint8_t *cmdBuf, int cmdSize, long *writtenSize ){
 	// int writtenSize = 0;
 
 
-	MakeCommand_mnt_Cleaning = dlsym( _libclss, "CNCL_MakeCommand_Cleaning" );
+	MakeCommand_mnt_Cleaning = CNCL_API( MakeCommand_Cleaning );
 
-	if ( dlerror() != NULL ) {
+	if ( MakeCommand_mnt_Cleaning == NULL ) {
 		fprintf( stderr, "[cmdtocanonij3] Load Error in CNCL_MakeCommand_Cleaning\n" );
 		rtn = ERR_MAKE_COMMAND;
 		goto error_exit;
@@ -349,9 +348,9 @@ int MakeCommand_AutoAlignment( uint8_t *cmdBuf, long cmdSize, long *writtenSize
 	// long writtenSize = 0;
 
 
-	MakeCommand_mnt_AutoAlignment = dlsym( _libclss, "CNCL_MakeCommand_AutoAlignment" );
+	MakeCommand_mnt_AutoAlignment = CNCL_API( MakeCommand_AutoAlignment );
 
-	if ( dlerror() != NULL ) {
+	if ( MakeCommand_mnt_AutoAlignment == NULL ) {
 		fprintf( stderr, "[cmdtocanonij3] Load Error in CNCL_MakeCommand_AutoAlignment\n" );
 		rtn = ERR_MAKE_COMMAND;
 		goto error_exit;
@@ -452,6 +451,7 @@ int main( int argc, char *argv[] ){
 	const char *p_ppd_name = getenv("PPD");
 	char	*xmlBuf_maintenance = NULL;
 	int		xmlBufSize_maintenance = 0;
+	CNIJ_CAPCACHE_BLOB	xmlBlob_maintenance = { NULL, 0, NULL, 0 };
 
 	// char	jobID[CN_START_JOBID_LEN];
 	char	jobDesc[UUID_LEN + 1];
@@ -532,23 +532,21 @@ int main( int argc, char *argv[] ){
 
 	snprintf( libPathBuf, CN_LIB_PATH_LEN - 1, CN_CNCL_LIB_PATH, model_number );
 
-	_libclss = dlopen( libPathBuf, RTLD_LAZY );
-
-	if ( !_libclss ) {
-		fprintf( stderr, "Error in dlopen\n" );
+	if ( CnclOpen( libPathBuf ) != 0 ) {
 		goto error_exit;
 	}
 
 
-	GetStringWithTagFromFile = dlsym( _libclss, "CNCL_GetStringWithTagFromFile" );
+	GetStringWithTagFromFile = CNCL_API( GetStringWithTagFromFile );
 
-	if ( dlerror() != NULL ) {
+	if ( GetStringWithTagFromFile == NULL ) {
 		fprintf( stderr, "Error in CNCL_GetStringWithTagFromFile\n" );
 		goto error_exit;
 	}
 
 
-	xmlBufSize_maintenance = GetStringWithTagFromFile( p_ppd_name, CNCL_FILE_TAG_CAPABILITY_MAINTENANCE, (int *)CNCL_DECODE_EXEC, (unsigned char **)&xmlBuf_maintenance );
+	xmlBufSize_maintenance = CapCacheGetStringWithTag( GetStringWithTagFromFile, p_ppd_name, CNCL_FILE_TAG_CAPABILITY_MAINTENANCE, CNCL_DECODE_EXEC, &xmlBlob_maintenance );
+	xmlBuf_maintenance = (char *)xmlBlob_maintenance.data;
 
 
 	// get maintenance command type
@@ -640,13 +638,7 @@ int main( int argc, char *argv[] ){
 
 
 end_proc:
-	if( xmlBuf_maintenance != NULL ){
-		free( xmlBuf_maintenance );
-	}
-
-	if ( _libclss != NULL ) {
-		dlclose( _libclss );
-	}
+	CapCacheRelease( &xmlBlob_maintenance );
 
 	if( cmdBuf != NULL ){
 		free( cmdBuf );
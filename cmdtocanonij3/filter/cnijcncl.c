@@ -0,0 +1,136 @@
+/*
+ *  Canon Inkjet Printer Driver for Linux
+ *  Copyright CANON INC. 2001-2024
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * NOTE:
+ *  - As a special exception, this program is permissible to link with the
+ *    libraries released as the binary modules.
+ *  - If you write modifications of your own for these programs, it is your
+ *    choice whether to permit this exception to apply to your modifications.
+ *    If you do not wish that, delete this exception.
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "cnijcncl.h"
+
+#define CNCL_STATE_UNRESOLVED	(0)
+#define CNCL_STATE_RESOLVED		(1)
+#define CNCL_STATE_MISSING		(2)
+
+typedef struct {
+	const char	*symbol;
+	void		*func;
+	int			state;
+} CNCL_ENTRY;
+
+static CNCL_ENTRY cnclTable[CNCL_ID_COUNT] = {
+#define CNCL_FUNC( name, symbol, ret, args )	{ symbol, NULL, CNCL_STATE_UNRESOLVED },
+	CNIJ_CNCL_FUNCTIONS
+#undef CNCL_FUNC
+};
+
+static void *libclss = NULL;
+static int openState = CNCL_STATE_UNRESOLVED;
+
+/* lgmon3 calls into the library from several threads, the table and the handle are kept under this lock */
+static pthread_mutex_t cnclLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* called with cnclLock held */
+static int CnclOpenLocked( const char *libPath )
+{
+	if ( openState == CNCL_STATE_UNRESOLVED ) {
+		if ( libPath == NULL ) {
+			libPath = CNIJ_CNCL_LIBNAME;
+		}
+		libclss = dlopen( libPath, RTLD_LAZY );
+		if ( libclss == NULL ) {
+			fprintf( stderr, "Error in dlopen : %s\n", dlerror() );
+			openState = CNCL_STATE_MISSING;
+		}
+		else {
+			openState = CNCL_STATE_RESOLVED;
+		}
+	}
+	return (openState == CNCL_STATE_RESOLVED) ? 0 : -1;
+}
+
+int CnclOpen( const char *libPath )
+{
+	int result;
+
+	pthread_mutex_lock( &cnclLock );
+	result = CnclOpenLocked( libPath );
+	pthread_mutex_unlock( &cnclLock );
+	return result;
+}
+
+void *CnclResolve( int id )
+{
+	CNCL_ENTRY *entry;
+	void *func = NULL;
+
+	if ( (id < 0) || (id >= CNCL_ID_COUNT) ) return NULL;
+	entry = &cnclTable[id];
+
+	pthread_mutex_lock( &cnclLock );
+	if ( entry->state == CNCL_STATE_UNRESOLVED ) {
+		if ( CnclOpenLocked( NULL ) == 0 ) {
+			dlerror();
+			func = dlsym( libclss, entry->symbol );
+			if ( (dlerror() == NULL) && (func != NULL) ) {
+				entry->func = func;
+				entry->state = CNCL_STATE_RESOLVED;
+			}
+			else {
+				fprintf( stderr, "Error in %s. API not Found.\n", entry->symbol );
+				entry->state = CNCL_STATE_MISSING;
+			}
+		}
+		else {
+			entry->state = CNCL_STATE_MISSING;
+		}
+	}
+	func = (entry->state == CNCL_STATE_RESOLVED) ? entry->func : NULL;
+	pthread_mutex_unlock( &cnclLock );
+	return func;
+}
+
+int CnclRequire( const int ids[], int count )
+{
+	int result = 0;
+	int i;
+
+	for ( i = 0; i < count; i++ ) {
+		if ( CnclResolve( ids[i] ) == NULL ) {
+			result = -1;
+		}
+	}
+	return result;
+}
+
+int CnclLibraryStat( struct stat *st )
+{
+	Dl_info info;
+	void *func = CnclResolve( 0 );
+
+	if ( (func == NULL) || (dladdr( func, &info ) == 0) || (info.dli_fname == NULL) ) return -1;
+	return stat( info.dli_fname, st );
+}
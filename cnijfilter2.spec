@@ -154,7 +154,7 @@ else
 	install -c -m 755 com/libs_bin%{_arc}/cnijlgmon3 ${RPM_BUILD_ROOT}%{_bindir}
 	install -c -m 644 cmdtocanonij2/utilfiles/*.utl ${RPM_BUILD_ROOT}%{_prefix}/share/cmdtocanonij2
 	install -c -m 644 cmdtocanonij3/utilfiles/*.utl ${RPM_BUILD_ROOT}%{_prefix}/share/cmdtocanonij3
-	install -c -m 644 lgmon3/keytext/*.res ${RPM_BUILD_ROOT}%{_prefix}/share/cnijlgmon3
+	install -c -m 644 lgmon3/keytext/*.cat ${RPM_BUILD_ROOT}%{_prefix}/share/cnijlgmon3
 	install -c -m 644 com/libs_bin%{_arc}/de/LC_MESSAGES/cnijlgmon3.mo ${RPM_BUILD_ROOT}%{_prefix}/share/locale/de/LC_MESSAGES
 	install -c -m 644 com/libs_bin%{_arc}/fr/LC_MESSAGES/cnijlgmon3.mo ${RPM_BUILD_ROOT}%{_prefix}/share/locale/fr/LC_MESSAGES
 	install -c -m 644 com/libs_bin%{_arc}/ja/LC_MESSAGES/cnijlgmon3.mo ${RPM_BUILD_ROOT}%{_prefix}/share/locale/ja/LC_MESSAGES
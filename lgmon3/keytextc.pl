@@ -0,0 +1,60 @@
+#!/usr/bin/perl
+#
+# Compile keytext/cnb_cnijlgmon2.res into the binary catalog keytext.c maps.
+#
+# The resource holds a handful of items, so the catalog is just the items
+# sorted by key, looked up with a binary search. The text is stored as in
+# the resource; it is still translated with dgettext at lookup.
+#
+# layout, all numbers 32bit little endian:
+#   "CNKTC02\0", item count,
+#   item count x { key offset, text offset }   (sorted by key, as strcmp)
+#   NUL terminated strings
+#
+
+sub unescape {
+	my ($str) = @_;
+
+	$str =~ s/&lt;/</g;
+	$str =~ s/&gt;/>/g;
+	$str =~ s/&quot;/"/g;
+	$str =~ s/&apos;/'/g;
+	$str =~ s/&#x([0-9a-fA-F]+);/chr(hex($1))/ge;
+	$str =~ s/&#([0-9]+);/chr($1)/ge;
+	$str =~ s/&amp;/&/g;
+	return $str;
+}
+
+while(<>) {
+	$keytext = $keytext.$_;
+}
+
+$keytext =~ /<(KeyTextList)>([\w\W]*?)<\/\1>/i or die "no KeyTextList\n";
+$itemlist = $2;
+
+%text = ();
+while ( $itemlist =~ /<(Item)([^>]*?)>([\w\W]*?)<\/\1>/ig ) {
+	my $item = $2;
+	my $str = $3;
+
+	next if ( $item !~ /key *= *\"([^\"]*)\"/i );
+	my $key = unescape($1);
+	next if ( exists $text{$key} );	# first entry wins, as in the linear scan
+	$text{$key} = unescape($str);
+}
+
+@keys = sort keys %text;
+
+$pool = "";
+$pooltop = 12 + 8 * scalar(@keys);
+$table = "";
+foreach $key ( @keys ) {
+	my $keyoff = $pooltop + length($pool);
+	$pool .= $key."\0";
+	my $textoff = $pooltop + length($pool);
+	$pool .= $text{$key}."\0";
+	$table .= pack( "VV", $keyoff, $textoff );
+}
+
+binmode STDOUT;
+print "CNKTC02\0", pack( "V", scalar(@keys) ), $table, $pool;
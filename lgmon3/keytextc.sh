@@ -0,0 +1,2 @@
+#!/bin/sh
+/usr/bin/perl keytextc.pl <keytext/cnb_cnijlgmon2.res >keytext/cnb_cnijlgmon2.cat
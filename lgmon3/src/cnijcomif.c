@@ -29,8 +29,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
+#include <strings.h>
 #include <netdb.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/time.h>
 #include <libusb.h>
@@ -44,6 +47,32 @@
 
 // #define _DEBUG_MODE_
 
+#define CN_DISCOVER_DEV_MAX		(256)
+#define CN_DISCOVER_KEY_LEN		(CN_SERIAL_NUM_LEN + 8)
+
+/* devices printed by the searches, "port:serial" */
+static char discoverKey[CN_DISCOVER_DEV_MAX][CN_DISCOVER_KEY_LEN];
+static int discoverNum = 0;
+static pthread_mutex_t discoverLock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *CNIF_USB_DiscoverThread(void *arg)
+{
+	*(int *)arg = CNIF_USB_Discover();
+	return NULL;
+}
+
+static void *CNIF_Network_DiscoverThread(void *arg)
+{
+	*(int *)arg = CNIF_Network_Discover(0);
+	return NULL;
+}
+
+static void *CNIF_Network2_DiscoverThread(void *arg)
+{
+	*(int *)arg = CNIF_Network2_Discover(0);
+	return NULL;
+}
+
 
 int CNIF_Open(const char *_deviceID, CNIF_INFO *_if_info)
 {
@@ -153,6 +182,25 @@ int CNIF_Write(CNIF_INFO *_if_info, uint8_t *buffer, size_t bufferSize, size_t *
 	return err;
 }
 
+int CNIF_Flush(CNIF_INFO *_if_info)
+{
+	int err = 0;
+
+	switch (_if_info->ifType)
+	{
+		case CNIF_TYPE_USB:
+			err = CNIF_USB_Flush();
+			if (err == LIBUSB_ERROR_TIMEOUT || err == LIBUSB_ERROR_INTERRUPTED) {
+				/* the data is still queued */
+				return CN_LGMON_BUSY;
+			}
+			return err;
+		default:
+			break;
+	}
+	return CN_LGMON_OK;
+}
+
 int CNIF_Send(CNIF_INFO *_if_info, uint8_t *buffer, size_t bufferSize, size_t *writtenSize)
 {
 	int err = 0;
@@ -243,9 +291,29 @@ int CNIF_Discover(CNIF_INFO *_if_info, int installer)
 		fprintf(stderr, "DEBUG: CNIF_Discover normal mode\n");
 #endif
 
-		err_usb = CNIF_USB_Discover();
-		err_net = CNIF_Network_Discover(installer);
-		err_net2 = CNIF_Network2_Discover(installer);
+		/* the searches wait on different transports, run them at the same time */
+		pthread_t th_usb, th_net, th_net2;
+		int run_usb, run_net, run_net2;
+
+		run_usb = (pthread_create(&th_usb, NULL, CNIF_USB_DiscoverThread, &err_usb) == 0);
+		run_net = (pthread_create(&th_net, NULL, CNIF_Network_DiscoverThread, &err_net) == 0);
+		run_net2 = (pthread_create(&th_net2, NULL, CNIF_Network2_DiscoverThread, &err_net2) == 0);
+
+		if (run_usb) {
+			pthread_join(th_usb, NULL);
+		} else {
+			err_usb = CNIF_USB_Discover();
+		}
+		if (run_net) {
+			pthread_join(th_net, NULL);
+		} else {
+			err_net = CNIF_Network_Discover(installer);
+		}
+		if (run_net2) {
+			pthread_join(th_net2, NULL);
+		} else {
+			err_net2 = CNIF_Network2_Discover(installer);
+		}
 
 		if (err_usb < 0) {
 			return err_usb;
@@ -289,6 +357,46 @@ int CNIF_Discover(CNIF_INFO *_if_info, int installer)
 	return CN_LGMON_OK;
 }
 
+/*
+ * Print one device line of the discovery. The line is flushed at once, and
+ * a device that another search has already printed (the same port and
+ * serial) is skipped. Returns 1 when the line was printed.
+ */
+int CNIF_PrintDevice(const char *port, const char *serial, const char *format, ...)
+{
+	va_list ap;
+	char key[CN_DISCOVER_KEY_LEN];
+	int i;
+	int printed = 0;
+
+	snprintf(key, sizeof(key), "%s:%s", port, serial);
+
+	pthread_mutex_lock(&discoverLock);
+
+	for (i = 0; i < discoverNum; i++) {
+		if (strcasecmp(discoverKey[i], key) == 0) {
+#ifdef _DEBUG_MODE_
+			fprintf(stderr, "DEBUG: [discover] %s is already listed\n", key);
+#endif
+			goto onErr;
+		}
+	}
+	if (discoverNum < CN_DISCOVER_DEV_MAX) {
+		strncpy(discoverKey[discoverNum], key, CN_DISCOVER_KEY_LEN - 1);
+		discoverNum++;
+	}
+
+	va_start(ap, format);
+	vfprintf(stdout, format, ap);
+	va_end(ap);
+	fflush(stdout);
+	printed = 1;
+
+onErr:
+	pthread_mutex_unlock(&discoverLock);
+	return printed;
+}
+
 int CNIF_Cancel(CNIF_INFO *_if_info)
 {
 	switch (_if_info->ifType)
@@ -53,9 +53,11 @@ int CNIF_Close(CNIF_INFO *_if_info);
 int CNIF_Reset(CNIF_INFO *_if_info);
 int CNIF_Read(CNIF_INFO *_if_info, uint8_t *buffer, size_t bufferSize, size_t *readSize, int isPrinting);
 int CNIF_Write(CNIF_INFO *_if_info, uint8_t *buffer, size_t bufferSize, size_t *writtenSize);
+int CNIF_Flush(CNIF_INFO *_if_info);
 int CNIF_Send(CNIF_INFO *_if_info, uint8_t *buffer, size_t bufferSize, size_t *writtenSize);
 int CNIF_Cancel(CNIF_INFO *_if_info);
 int CNIF_Discover(CNIF_INFO *_if_info, int installer);
+int CNIF_PrintDevice(const char *port, const char *serial, const char *format, ...);
 int CNIF_GetSerialNum(CNIF_INFO *if_info, uint8_t *buffer, size_t bufferSize, char *serial);
 int CNIF_MakeDeviceUri(CNIF_INFO *if_info, uint8_t *uri_buffer, size_t size);
 int CNIF_KeepSession(CNIF_INFO *_if_info);
@@ -41,6 +41,7 @@
 #include <signal.h>
 #include <poll.h>
 #include <dlfcn.h>
+#include <time.h>
 
 #include <libcnnet.h>
 #include "cnijcomif.h"
@@ -53,6 +54,12 @@
 
 static CNNLHANDLE    hnd = NULL;
 static int isCanceled = 0;
+static NET_TRANSFER_STAT netStat;
+static WAIT_POLICY busyWait;
+static WAIT_POLICY downWait;
+
+static unsigned long long GetMsec(void);
+static void WaitNetwork(WAIT_POLICY *wait);
 //static unsigned long packet_size= 4*1024;
 
 
@@ -141,6 +148,11 @@ int CNIF_Network_StartSession()
 			
 		/* set timeout */
 		CNNL_SetTimeout(hnd, SESSION_TIMEOUT, 3, 15000);
+
+		memset(&netStat, 0, sizeof(netStat));
+		netStat.startMsec = GetMsec();
+		InitWaitPolicy(&busyWait, NET_WAIT_BUSY_FIRST, NET_WAIT_BUSY_MAX);
+		InitWaitPolicy(&downWait, NET_WAIT_DOWN_FIRST, NET_WAIT_DOWN_MAX);
 		return CN_LGMON_OK;
 	}
 	
@@ -158,6 +170,15 @@ int CNIF_Network_StartSession()
 
 int CNIF_Network_Close()
 {
+	if (netStat.startMsec != 0){
+		unsigned long long msec = GetMsec() - netStat.startMsec;
+
+		fprintf(stderr, "DEBUG: [NET] %llu bytes in %llu msec, %lu writes (%lu busy), %lu reads (%lu busy), %llu msec waited\n",
+			netStat.sentBytes, msec, netStat.writeCalls, netStat.writeBusy,
+			netStat.readCalls, netStat.readBusy, netStat.waitMsec);
+		netStat.startMsec = 0;
+	}
+
 	CNNL_SessionEnd(hnd, 5, 30000);
 	
 	if (hnd != NULL){
@@ -173,20 +194,45 @@ int CNIF_Network_Reset()
 	return CN_LGMON_OK;
 }
 
+static unsigned long long GetMsec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* the next wait of the policy, cut short by SIGTERM, the time actually waited is counted in the statistics */
+static void WaitNetwork(WAIT_POLICY *wait)
+{
+	unsigned long long start = GetMsec();
+
+	WaitWithPolicy(wait, &interrupt_sign);
+	netStat.waitMsec += GetMsec() - start;
+}
+
 int CNIF_Network_Read(uint8_t *buffer, size_t bufferSize, size_t *readSize)
 {
-	int i=0;
-	for (i=0; i<20; i++)
+	WAIT_POLICY readWait;
+	unsigned long long limit = GetMsec() + NET_READ_BUSY_LIMIT;
+
+	InitWaitPolicy(&readWait, NET_WAIT_READ_FIRST, NET_WAIT_READ_MAX);
+
+	while (1)
 	{
 		int result = CNNL_DataRead(hnd, buffer, (long unsigned int *)readSize, bufferSize, 3, 9000);
-		
+
+		netStat.readCalls++;
+
 		if (result == CNNL_RET_SUCCESS){
 			//fprintf(stderr, "DEBUG: ---CNNL_DataRead From---------------------------------------------\n");
 			//fprintf(stderr, "%s\n", buffer);
 			//fprintf(stderr, "DEBUG: ---CNNL_DataRead To  ---------------------------------------------\n");
 			return CN_LGMON_OK;
 		} else if (result == CNNL_RET_BUSY_RESPONSE){
-			sleep(1);
+			netStat.readBusy++;
+			if (isCanceled || interrupt_sign || GetMsec() >= limit) break;
+			WaitNetwork(&readWait);
 			continue;
 		} else {
 			return CN_LGMON_ERROR;
@@ -198,14 +244,28 @@ int CNIF_Network_Read(uint8_t *buffer, size_t bufferSize, size_t *readSize)
 int CNIF_Network_Write(uint8_t *buffer, size_t bufferSize, size_t *writtenSize)
 {
 	int result = CNNL_DataWrite(hnd, buffer, bufferSize, (long unsigned int *)writtenSize, 5, 30000);
-			
+
+	netStat.writeCalls++;
+	netStat.sentBytes += *writtenSize;
+
 	if (result == CNNL_RET_SUCCESS){
+		ResetWaitPolicy(&busyWait);
+		ResetWaitPolicy(&downWait);
 		return CN_LGMON_OK;
 	} else if (result == CNNL_RET_FAILURE){
 		return CN_LGMON_ERROR;
 	} else {
-		// busy
-		usleep(40*1000);
+		// busy, the caller sends the rest again
+		netStat.writeBusy++;
+
+		if (*writtenSize > 0){
+			/* the printer still takes data, retry at once */
+			ResetWaitPolicy(&busyWait);
+		} else if (result == CNNL_RET_NOT_WORKING || result == CNNL_RET_POWEROFF){
+			WaitNetwork(&downWait);
+		} else {
+			WaitNetwork(&busyWait);
+		}
 		return CN_LGMON_OK;
 	}
 }
@@ -235,6 +295,7 @@ int CNIF_Network_Discover(int installer)
 	char          model[STRING_SHORT];
 	char          model2[STRING_SHORT];
 	char          ipaddr[STRING_SHORT];
+	char          macaddr[STRING_SHORT];
 	int           i=0, j=0, max = MAX_COUNT_OF_PRINTERS, found=0;
 	
 	if (CNNL_Init(&hmdl) != CNNL_RET_SUCCESS) goto error;
@@ -269,21 +330,18 @@ int CNIF_Network_Discover(int installer)
 						}
 					}
 					
-					if (installer != 1){
-						/* cups list device mode */
-						printf("network cnijbe2://Canon/?port=net&serial=%02X-%02X-%02X-%02X-%02X-%02X \"%s\" \"%s_%02X-%02X-%02X-%02X-%02X-%02X\"\n", 
-							nic[j].macaddr[0],nic[j].macaddr[1],nic[j].macaddr[2],
-							nic[j].macaddr[3],nic[j].macaddr[4],nic[j].macaddr[5],
-							model,
-							model2,
+					snprintf(macaddr, STRING_SHORT-1, "%02X-%02X-%02X-%02X-%02X-%02X",
 							nic[j].macaddr[0],nic[j].macaddr[1],nic[j].macaddr[2],
 							nic[j].macaddr[3],nic[j].macaddr[4],nic[j].macaddr[5]);
+
+					if (installer != 1){
+						/* cups list device mode */
+						CNIF_PrintDevice("net", macaddr, "network cnijbe2://Canon/?port=net&serial=%s \"%s\" \"%s_%s\"\n", 
+							macaddr, model, model2, macaddr);
 					} else {
 						/* installer mode */
-						printf("network cnijbe2://Canon/?port=net&serial=%02X-%02X-%02X-%02X-%02X-%02X \"%s\" \"IP:%s\"\n", 
-							nic[j].macaddr[0],nic[j].macaddr[1],nic[j].macaddr[2],
-							nic[j].macaddr[3],nic[j].macaddr[4],nic[j].macaddr[5],
-							model, ipaddr);
+						CNIF_PrintDevice("net", macaddr, "network cnijbe2://Canon/?port=net&serial=%s \"%s\" \"IP:%s\"\n", 
+							macaddr, model, ipaddr);
 					}
 				}
 				CNNL_Close(hmdl);
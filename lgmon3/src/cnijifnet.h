@@ -38,6 +38,26 @@
 #define STRING_SHORT            (32)
 #define SESSION_TIMEOUT         (60)
 
+/* waits in msec while the printer does not take or return data */
+#define NET_WAIT_BUSY_FIRST     (2)         /* CNNL_RET_BUSY, CNNL_RET_BUSY_RESPONSE */
+#define NET_WAIT_BUSY_MAX       (40)
+#define NET_WAIT_DOWN_FIRST     (100)       /* CNNL_RET_NOT_WORKING, CNNL_RET_POWEROFF */
+#define NET_WAIT_DOWN_MAX       (1000)
+#define NET_WAIT_READ_FIRST     (50)        /* busy response to CNNL_DataRead */
+#define NET_WAIT_READ_MAX       (1000)
+#define NET_READ_BUSY_LIMIT     (20 * 1000) /* give up a busy read after this long */
+
+/* transfer statistics of the session, logged at close */
+typedef struct {
+	unsigned long long sentBytes;
+	unsigned long writeCalls;
+	unsigned long writeBusy;
+	unsigned long readCalls;
+	unsigned long readBusy;
+	unsigned long long waitMsec;
+	unsigned long long startMsec;
+} NET_TRANSFER_STAT;
+
 int CNIF_Network_Open(const char *_deviceID, CNIF_INFO *_if_info);
 int CNIF_Network_StartSession();
 int CNIF_Network_Close();
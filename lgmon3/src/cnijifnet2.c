@@ -41,11 +41,15 @@
 #include <signal.h>
 #include <poll.h>
 #include <dlfcn.h>
+#include <time.h>
 
 #include <libcnnet3.h>
 #include "cnijcomif.h"
 #include "cnijlgmon3.h"
 #include "cnijifnet2.h"
+#include "cnijcapcache.h"
+#include "cnijnetcache.h"
+#include "cnijcncl.h"
 // #include "cnijutil.h"
 #include "./common/libcnnet3_type.h"
 #include "./common/libcnnet3_url.h"
@@ -71,7 +75,12 @@ static int (*pCNNET2_SearchByIpv6)(void *instance, const char *ipv6Address, sear
 static void (*pCNNET2_CancelSearch)(void *instance);
 static CNNET2_ERROR_CODE (*pCNNET2_EnumSearchInfo)(void *instance, tagSearchPrinterInfo *searchPrinterInfoList, unsigned int *ioSize);
 static void callback_CNNET2_Search(void *data, const tagSearchPrinterInfo *printerInfo);
-static int (*GetStringWithTagFromFile)( const char* , const char* , int* , uint8_t** );
+static int SearchPrinters( const char *ipv4Address, unsigned int timeout, int *installer );
+static int FindNetwork2Dev( const char *macAddr );
+static void StoreNetwork2Dev( CNCL_TYPE_GetProtocol getProtocol );
+static void InitSendWindow( void );
+static void AdaptSendWindow( unsigned long size, unsigned long sentSize, long msec );
+static void SetSendTimeout( unsigned long size );
 
 static char *ipAddr;
 static NETWORK_DEV	network2dev[NETWORK_DEV_MAX];
@@ -81,7 +90,26 @@ static int foundNum;
 static HCNNET3 port9100Writer;
 static HCNNET3 chmpWriter;
 
-static char model_number[] = "com2";
+/* control channel of the status polling, kept open for the session */
+typedef struct {
+	HCNNET3	hnd;					/* NULL until the first poll or after a failure */
+	int		isCapChecked;
+	int		hasMaintenance;			/* the PPD has the maintenance capability */
+	char	cmdPrint[CNMPU2_SEND_DATA_SIZE];		/* GetStatusPrint, built on first use */
+	char	cmdMaintenance[CNMPU2_SEND_DATA_SIZE];	/* GetStatusMaintenance, built on first use */
+} NET2_STATUS_SESSION;
+
+static NET2_STATUS_SESSION statusSession;
+
+/* CNNET3_Send size of the data channel, adapted to the measured send time */
+typedef struct {
+	unsigned long	maxSize;		/* CNMPU2_SEND_SIZE_ENV */
+	unsigned long	chunkSize;
+	unsigned int	timeout;		/* sec, last value given to CNNET3_SetTimeout, 0 before */
+} NET2_SEND_WINDOW;
+
+static NET2_SEND_WINDOW sendWindow;
+
 
 #ifdef _DEFAULT_PATH_
 #define BJLIB_PATH "/usr/lib/bjlib/"
@@ -91,10 +119,6 @@ static char model_number[] = "com2";
 		__asm__(".symver memcpy, memcpy@GLIBC_2.2.5");
 #endif
 
-int (*CNCL_MakeCommand_CancelJob)(char *, char *, unsigned int, unsigned int *);
-int (*CNCL_MakeCommand_GetStatus)(char *, unsigned int, unsigned int *);
-int (*GET_PROTOCOL)(char *, size_t);
-static int (*GetStringWithTagFromFile)( const char* , const char* , int* , uint8_t** );
 
 // #define _DEBUG_MODE_
 
@@ -148,6 +172,8 @@ CNNET3_ERROR CNIF_Network2_StartSession()
 		return ret;
 	}
 
+	InitSendWindow();
+
 	return CNNET3_ERR_SUCCESS;
 }
 
@@ -158,6 +184,11 @@ CNNET3_ERROR CNIF_Network2_EndSession()
 
 	CNNET3_Close(port9100Writer);
 
+	if( statusSession.hnd != NULL ){
+		CNNET3_Close( statusSession.hnd );
+	}
+	memset( &statusSession, 0, sizeof(statusSession) );
+
 	if( ipAddr != NULL ){
 		free( ipAddr );
 	}
@@ -168,11 +199,11 @@ CNNET3_ERROR CNIF_Network2_EndSession()
 
 
 // CNNET3_ERROR CNIF_Network2_WriteData(unsigned char *sendBuffer, unsigned long bufferSize, int needContinue)
-CNNET3_ERROR CNIF_Network2_WriteData( char *sendBuffer, unsigned long bufferSize, int needContinue )
+CNNET3_ERROR CNIF_Network2_WriteData( HCNNET3 hnd, char *sendBuffer, unsigned long bufferSize, int needContinue )
 {
 	CNNET3_ERROR ret = CN_NET3_SUCCEEDED;
 
-	ret = CNNET3_Write(chmpWriter, (unsigned char *)sendBuffer, bufferSize, needContinue);
+	ret = CNNET3_Write(hnd, (unsigned char *)sendBuffer, bufferSize, needContinue);
 
 	return ret;
 }
@@ -184,40 +215,56 @@ CNNET3_ERROR CNIF_Network2_SendData( unsigned char *sendBuffer, unsigned long bu
 	int ret = 0;
 	int cnt_timeout = 0;
 
+	if( sendWindow.chunkSize == 0 ){
+		InitSendWindow();
+	}
+
     for (*writtenSize = 0; *writtenSize < bufferSize; ) {
         unsigned long bufSize = bufferSize - *writtenSize;
         unsigned long sentSize = 0;
+		struct timespec start, end;
+		long msec;
 
-		if(bufSize > CNMPU2_SEND_DATA_SIZE){
-			bufSize = CNMPU2_SEND_DATA_SIZE;
+		if(bufSize > sendWindow.chunkSize){
+			bufSize = sendWindow.chunkSize;
 		}
 
+		SetSendTimeout( bufSize );
+
 #ifdef _DEBUG_MODE_
-		fprintf(stderr, "DEBUG: [CNNET3_Send] call\n");
+		fprintf(stderr, "DEBUG: [CNNET3_Send] call size = %lu\n", bufSize);
 #endif
 
+		clock_gettime( CLOCK_MONOTONIC, &start );
         ret = CNNET3_Send(port9100Writer, (sendBuffer + *writtenSize), bufSize, &sentSize);
+		clock_gettime( CLOCK_MONOTONIC, &end );
+		msec = (end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000;
 
 #ifdef _DEBUG_MODE_
-		fprintf(stderr, "DEBUG: [CNNET3_Send] ret = %d\n", ret);
+		fprintf(stderr, "DEBUG: [CNNET3_Send] ret = %d, sent = %lu, %ld msec\n", ret, sentSize, msec);
 #endif
 
         if (ret == CNNET3_ERR_SUCCESS) {
             // CNIJLOG_MSG(@"SUCCESS!");
             *writtenSize += sentSize;
 			cnt_timeout = 0;
+
+			AdaptSendWindow( bufSize, sentSize, msec );
         }
         else if (ret == CNNET3_ERR_WRITING_TIMEOUT) {
             // CNIJLOG_MSG(@"!!!!!TIMEOUT!!!!!");
             *writtenSize += sentSize;
 
-			cnt_timeout++;
+			/* a slow printer that still takes data is not a failure */
+			cnt_timeout = ( sentSize > 0 ) ? 0 : cnt_timeout + 1;
+
+			AdaptSendWindow( bufSize, 0, msec );
         }
         else {
             break;
         }
 
-		if( cnt_timeout >= 3 ) {
+		if( cnt_timeout >= CNMPU2_SEND_TIMEOUT_RETRY ) {
 			ret = CN_NET3_SEND_TIMEOUT;
 			break;
 		}
@@ -227,117 +274,184 @@ CNNET3_ERROR CNIF_Network2_SendData( unsigned char *sendBuffer, unsigned long bu
 }
 
 
-
-CNNET3_ERROR CNIF_Network2_Discover(int installer)
+static void InitSendWindow( void )
 {
-	char	model[LEN_MODEL_NAME];
-	char	model2[LEN_MODEL_NAME];
-	char	ipaddr[LEN_IP_ADDR];
-	int		i=0, j=0;
+	const char *env = getenv( CNMPU2_SEND_SIZE_ENV );
 
-	void	*libclss = NULL;
-	char	*library_path = NULL;
-	int		prot = 0;
-	char	model_number[] = "com2";
+	memset( &sendWindow, 0, sizeof(sendWindow) );
+	sendWindow.maxSize = CNMPU2_SEND_SIZE_DEFAULT;
 
+	if( env != NULL && atol( env ) > 0 ){
+		sendWindow.maxSize = (unsigned long)atol( env );
+		if( sendWindow.maxSize < CNMPU2_SEND_DATA_SIZE ) sendWindow.maxSize = CNMPU2_SEND_DATA_SIZE;
+		if( sendWindow.maxSize > CNMPU2_SEND_SIZE_MAX ) sendWindow.maxSize = CNMPU2_SEND_SIZE_MAX;
+	}
 
-	library_path = (char *)malloc(CN_LIB_PATH_LEN);
+	sendWindow.chunkSize = CNMPU2_SEND_SIZE_START;
+	if( sendWindow.chunkSize > sendWindow.maxSize ) sendWindow.chunkSize = sendWindow.maxSize;
+}
+
+
+/*
+ * Grow the chunk while the printer takes full chunks quickly and shrink it
+ * when a send stalls, so a busy printer is not held up by one large write.
+ */
+static void AdaptSendWindow( unsigned long size, unsigned long sentSize, long msec )
+{
+	unsigned long chunkSize = sendWindow.chunkSize;
+
+	if( sentSize < size || msec > CNMPU2_SEND_SLOW_MSEC ){
+		chunkSize /= 2;
+		if( chunkSize < CNMPU2_SEND_DATA_SIZE ) chunkSize = CNMPU2_SEND_DATA_SIZE;
+	}
+	else if( size == sendWindow.chunkSize && msec < CNMPU2_SEND_FAST_MSEC ){
+		chunkSize *= 2;
+		if( chunkSize > sendWindow.maxSize ) chunkSize = sendWindow.maxSize;
+	}
 
-	if(library_path == NULL) {
 #ifdef _DEBUG_MODE_
-		fprintf(stderr, "ERROR: malloc library_path" );
-#endif
-		return CN_NET3_FAILED;
+	if( chunkSize != sendWindow.chunkSize ){
+		fprintf(stderr, "DEBUG: [SendWindow] %lu -> %lu\n", sendWindow.chunkSize, chunkSize);
 	}
+#endif
 
-	memset(library_path, 	'\0', CN_LIB_PATH_LEN);
-	snprintf(library_path, CN_LIB_PATH_LEN - 1, CN_CNCL_LIB_PATH, model_number);
+	sendWindow.chunkSize = chunkSize;
+}
 
 
-	libclss = dlopen(library_path, RTLD_LAZY);
+/* allow a chunk the base timeout plus its transfer time at the slowest expected rate */
+static void SetSendTimeout( unsigned long size )
+{
+	unsigned int timeout = CNMPU2_SEND_TIMEOUT_BASE + (size + CNMPU2_SEND_TIMEOUT_RATE - 1) / CNMPU2_SEND_TIMEOUT_RATE;
 
-	if(!libclss){
-#ifdef _DEBUG_MODE_
-		fprintf(stderr, "ERROR: dynamic link error.(%s)", dlerror());
-#endif
-		return CN_LGMON_DYNAMID_LINK_ERROR;
+	if( timeout == sendWindow.timeout ){
+		return;
 	}
 
+	if( CNNET3_SetTimeout( port9100Writer, CNNET3_TOSETTING_CLIENT, timeout ) == CNNET3_ERR_SUCCESS ){
+		sendWindow.timeout = timeout;
+	}
+}
 
-	GET_PROTOCOL = dlsym(libclss, "CNCL_GetProtocol");
 
-	if(dlerror() != NULL){
-#ifdef _DEBUG_MODE_
-		fprintf(stderr, "DEBUG: cannnot find function4.(%s)", dlerror());
-#endif
 
-		return CN_LGMON_DYNAMID_LINK_ERROR;
+static int SetNetworkDev( NETWORK_DEV *dev, const tagSearchPrinterInfo *info )
+{
+	char	*cnt_cn = NULL;
+	char	*cnt_ser = NULL;
+
+	strncpy( dev->modelName_, info->modelName_, LEN_MODEL_NAME );
+	strncpy( dev->ipAddressStr_, info->ipAddressStr_, LEN_IP_ADDR );
+	snprintf( dev->macAddressStr_, LEN_MAC_ADDR, "%c%c-%c%c-%c%c-%c%c-%c%c-%c%c",
+			info->MacAddressStr_[0], info->MacAddressStr_[1], info->MacAddressStr_[2], info->MacAddressStr_[3],
+			info->MacAddressStr_[4], info->MacAddressStr_[5], info->MacAddressStr_[6], info->MacAddressStr_[7],
+			info->MacAddressStr_[8], info->MacAddressStr_[9], info->MacAddressStr_[10], info->MacAddressStr_[11] );
+	strncpy( dev->deviceId_, info->deviceId_, LEN_DEVICE_ID );
+
+	cnt_cn = strstr( dev->modelName_, MODEL_CANON );
+	cnt_ser = strstr( dev->modelName_, MODEL_SERIES );
+
+	if( cnt_cn == NULL || cnt_ser == NULL ){
+		const char *cnt_des;
+		const char *cnt_colon;
+
+		cnt_des = strstr( info->deviceId_, MODEL_DES );
+
+		if( cnt_des == NULL ){
+			return CN_NET3_FAILED;
+		}
+
+		cnt_colon = strstr( cnt_des, MODEL_SEMICLN );
+
+		if( cnt_colon == NULL ){
+			return CN_NET3_FAILED;
+		}
+
+		strncpy( dev->modelName_, cnt_des + sizeof( MODEL_DES ) - 1, strlen( cnt_des ) - strlen( cnt_colon ) - sizeof( MODEL_DES ) + 1 );
 	}
 
+	return CN_NET3_SUCCEEDED;
+}
 
-	if( SearchSnmp() == CNNET2_ERROR_CODE_SUCCESS ){
-		int cnt = 0;
 
-		for (j = 0; j < foundNum; j++){
+/* print a device that speaks the NET2 protocol, returns 1 when it does */
+static int PrintNetwork2Dev( const NETWORK_DEV *dev, int installer, CNCL_TYPE_GetProtocol getProtocol )
+{
+	char	model[LEN_MODEL_NAME];
+	char	model2[LEN_MODEL_NAME];
+	char	ipaddr[LEN_IP_ADDR];
+	char	macaddr[LEN_MAC_ADDR];
+	int		i = 0;
+	int		prot = 0;
 
-			prot = GET_PROTOCOL( (char *)network2dev[j].deviceId_, sizeof(network2dev[j].deviceId_) );
+	prot = getProtocol( (char *)dev->deviceId_, sizeof(dev->deviceId_) );
 
 #ifdef _DEBUG_MODE_
-			fprintf(stderr, "DEBUG: [Discover] prot = %d\n", prot);
-			fprintf(stderr, "DEBUG: [Discover] network2dev[%d].deviceId_ = %s\n", j, network2dev[j].deviceId_ );
+	fprintf(stderr, "DEBUG: [Discover] prot = %d\n", prot);
+	fprintf(stderr, "DEBUG: [Discover] deviceId_ = %s\n", dev->deviceId_ );
 #endif
 
-			if( prot == 2 ){
-				memset( model, 0x00, sizeof(model) );
-				memset( model2, 0x00, sizeof(model2) );
-				memset( ipaddr, 0x00, sizeof(ipaddr) );
-
-				strncpy( ipaddr, network2dev[j].ipAddressStr_, LEN_IP_ADDR );
-
-				strncpy( model, network2dev[j].modelName_, LEN_MODEL_NAME );
-
-				for (i=0; model[i]!='\0'; i++){
-					if (model[i] == ' '){
-						model2[i]='-';
-					} else {
-						model2[i]=model[i];
-					}
-				}
-
-				if (installer != 1){
-					printf("network cnijbe2://Canon/?port=net&serial=%c%c-%c%c-%c%c-%c%c-%c%c-%c%c \"%s\" \"%s_%c%c-%c%c-%c%c-%c%c-%c%c-%c%c\"\n",
-						network2dev[j].macAddressStr_[0], network2dev[j].macAddressStr_[1], network2dev[j].macAddressStr_[3],
-						network2dev[j].macAddressStr_[4], network2dev[j].macAddressStr_[6], network2dev[j].macAddressStr_[7],
-						network2dev[j].macAddressStr_[9], network2dev[j].macAddressStr_[10], network2dev[j].macAddressStr_[12],
-						network2dev[j].macAddressStr_[13], network2dev[j].macAddressStr_[15], network2dev[j].macAddressStr_[16],
-						model,
-						model2,
-						network2dev[j].macAddressStr_[0], network2dev[j].macAddressStr_[1], network2dev[j].macAddressStr_[3],
-						network2dev[j].macAddressStr_[4], network2dev[j].macAddressStr_[6], network2dev[j].macAddressStr_[7],
-						network2dev[j].macAddressStr_[9], network2dev[j].macAddressStr_[10], network2dev[j].macAddressStr_[12],
-						network2dev[j].macAddressStr_[13], network2dev[j].macAddressStr_[15], network2dev[j].macAddressStr_[16]);
-				} else {
-					printf("network cnijbe2://Canon/?port=net&serial=%c%c-%c%c-%c%c-%c%c-%c%c-%c%c \"%s\" \"IP:%s\"\n", 
-						network2dev[j].macAddressStr_[0], network2dev[j].macAddressStr_[1], network2dev[j].macAddressStr_[3],
-						network2dev[j].macAddressStr_[4], network2dev[j].macAddressStr_[6], network2dev[j].macAddressStr_[7],
-						network2dev[j].macAddressStr_[9], network2dev[j].macAddressStr_[10], network2dev[j].macAddressStr_[12],
-						network2dev[j].macAddressStr_[13], network2dev[j].macAddressStr_[15], network2dev[j].macAddressStr_[16],
-						model, ipaddr);
-				}
+	if( prot != 2 ){
+		return 0;
+	}
 
-				cnt++;
-			}
+	memset( model, 0x00, sizeof(model) );
+	memset( model2, 0x00, sizeof(model2) );
+	memset( ipaddr, 0x00, sizeof(ipaddr) );
+
+	strncpy( ipaddr, dev->ipAddressStr_, LEN_IP_ADDR - 1 );
+	strncpy( model, dev->modelName_, LEN_MODEL_NAME - 1 );
+
+	for (i=0; model[i]!='\0'; i++){
+		if (model[i] == ' '){
+			model2[i]='-';
+		} else {
+			model2[i]=model[i];
 		}
+	}
 
-		foundNum = cnt;
+	snprintf( macaddr, sizeof(macaddr), "%c%c-%c%c-%c%c-%c%c-%c%c-%c%c",
+		dev->macAddressStr_[0], dev->macAddressStr_[1], dev->macAddressStr_[3],
+		dev->macAddressStr_[4], dev->macAddressStr_[6], dev->macAddressStr_[7],
+		dev->macAddressStr_[9], dev->macAddressStr_[10], dev->macAddressStr_[12],
+		dev->macAddressStr_[13], dev->macAddressStr_[15], dev->macAddressStr_[16] );
+
+	if (installer != 1){
+		CNIF_PrintDevice( "net", macaddr, "network cnijbe2://Canon/?port=net&serial=%s \"%s\" \"%s_%s\"\n",
+			macaddr, model, model2, macaddr );
+	} else {
+		CNIF_PrintDevice( "net", macaddr, "network cnijbe2://Canon/?port=net&serial=%s \"%s\" \"IP:%s\"\n",
+			macaddr, model, ipaddr );
 	}
 
-	if( libclss != NULL ){
-		dlclose(libclss);
+	return 1;
+}
+
+
+CNNET3_ERROR CNIF_Network2_Discover(int installer)
+{
+	int		j=0;
+
+	CNCL_TYPE_GetProtocol	getProtocol = CNCL_API( GetProtocol );
+
+
+	if( getProtocol == NULL ){
+		return CN_LGMON_DYNAMID_LINK_ERROR;
 	}
 
-	if( library_path != NULL ){
-		free(library_path);
+
+	if( SearchSnmp( &installer ) == CNNET2_ERROR_CODE_SUCCESS ){
+		int cnt = 0;
+
+		/* the devices are printed as the search finds them, this only adds ones the callback missed */
+		for (j = 0; j < foundNum; j++){
+			if( PrintNetwork2Dev( &network2dev[j], installer, getProtocol ) ){
+				cnt++;
+			}
+		}
+
+		StoreNetwork2Dev( getProtocol );
+		foundNum = cnt;
 	}
 
 	return CN_LGMON_OK;
@@ -349,48 +463,20 @@ CNNET3_ERROR CNIF_Network2_CancelPrint( char *jobID ){
     unsigned int	writtenSize = 0;
 	int				result = 0;
 	char			*data = NULL;
-	char			*library_path = NULL;
-	void			*libclss = NULL;
+	CNCL_TYPE_MakeCommand_CancelJob	makeCancelJob = NULL;
 
 	const char *p_ppd_name = getenv("PPD");
 	// char	libPathBuf[CN_LIB_PATH_LEN];
-	uint8_t	*xmlBuf_maintenance = NULL;
+	CNIJ_CAPCACHE_BLOB	xmlBlob_maintenance = { NULL, 0, NULL, 0 };
 	int		xmlBufSize_maintenance = 0;
 
 
-	library_path = (char *)malloc(CN_LIB_PATH_LEN);
-
-	if(library_path == NULL) {
-		result = CN_LGMON_OTHER_ERROR;
-		goto EXIT;
-	}
-
-	memset(library_path, '\0', CN_LIB_PATH_LEN);
-	snprintf(library_path, CN_LIB_PATH_LEN - 1, CN_CNCL_LIB_PATH, model_number);
-
-	libclss = dlopen(library_path, RTLD_LAZY);
-
-	if( ! libclss ){
-
-#ifdef _DEBUG_MODE_
-		fprintf(stderr, "DEBUG: [%s] dlopen failed\n", library_path);
-#endif
-
-		return CN_LGMON_DYNAMID_LINK_ERROR;
-	}
-
-	GetStringWithTagFromFile = NULL;
-	GetStringWithTagFromFile = dlsym( libclss, "CNCL_GetStringWithTagFromFile" );
-
-	if ( dlerror() != NULL ) {
-#ifdef _DEBUG_MODE_
-		fprintf( stderr, "Error in CNCL_GetStringWithTagFromFile\n" );
-#endif
+	if ( CNCL_API( GetStringWithTagFromFile ) == NULL ) {
 		result = CN_LGMON_DYNAMID_LINK_ERROR;
 		goto EXIT;
 	}
 
-	xmlBufSize_maintenance = GetStringWithTagFromFile( p_ppd_name, CNCL_FILE_TAG_CAPABILITY_MAINTENANCE, (int *)CNCL_DECODE_EXEC, &xmlBuf_maintenance );
+	xmlBufSize_maintenance = CapCacheGetStringWithTag( CNCL_API( GetStringWithTagFromFile ), p_ppd_name, CNCL_FILE_TAG_CAPABILITY_MAINTENANCE, CNCL_DECODE_EXEC, &xmlBlob_maintenance );
 
 
 	data = (char *) malloc(2048);
@@ -433,51 +519,19 @@ CNNET3_ERROR CNIF_Network2_CancelPrint( char *jobID ){
 		goto EXIT;
 	}
 
-	library_path = (char *)malloc(CN_LIB_PATH_LEN);
-
-	if(library_path == NULL) {
-		result = CN_LGMON_OTHER_ERROR;
-		goto EXIT;
-	}
-
-	memset(library_path, '\0', CN_LIB_PATH_LEN);
-	snprintf(library_path, CN_LIB_PATH_LEN - 1, CN_CNCL_LIB_PATH, model_number);
-
-	libclss = dlopen(library_path, RTLD_LAZY);
-
-	if( ! libclss ){
-		return CN_LGMON_DYNAMID_LINK_ERROR;
-	}
-
-
-	libclss = dlopen(library_path, RTLD_LAZY);
-
-	if( ! libclss ){
-
-#ifdef _DEBUG_MODE_
-		fprintf(stderr, "DEBUG: [%s] dlopen failed\n", library_path);
-#endif
-
-		return CN_LGMON_DYNAMID_LINK_ERROR;
-	}
-
-
 	if( xmlBufSize_maintenance == 0 ){
-		CNCL_MakeCommand_CancelJob = dlsym(libclss, "CNCL_MakeCommand_CancelJob");
+		makeCancelJob = CNCL_API( MakeCommand_CancelJob );
 	}
 	else{
-		CNCL_MakeCommand_CancelJob = dlsym(libclss, "CNCL_MakeCommand_CancelJob_Maintenance");
+		makeCancelJob = CNCL_API( MakeCommand_CancelJob_Maintenance );
 	}
 
-
-
-
-	if(dlerror() != NULL){
+	if( makeCancelJob == NULL ){
 		result = CN_LGMON_DYNAMID_LINK_ERROR;
 		goto EXIT;
 	}
 
-	result = CNCL_MakeCommand_CancelJob( jobID, data, 2048, &writtenSize );
+	result = makeCancelJob( jobID, data, 2048, &writtenSize );
 
 	if ( result != CN_NET3_SUCCEEDED ) {
 		result = CN_NET3_MAKE_CMD_FAIL;
@@ -486,7 +540,7 @@ CNNET3_ERROR CNIF_Network2_CancelPrint( char *jobID ){
 
 	// data = cmdBuffer;
 
-	result = sendData( data );
+	result = sendData( chmpWriter, data );
 
 	if ( result != CNNET3_ERR_SUCCESS){
 		// errorLine = __LINE__;
@@ -506,9 +560,7 @@ EXIT:
 		free( data );
 	}
 
-	if ( libclss != NULL ) {
-		dlclose( libclss );
-	}
+	CapCacheRelease( &xmlBlob_maintenance );
 
 	return result;
 }
@@ -517,38 +569,79 @@ EXIT:
 /* CNNET2 Functions */
 CNNET3_ERROR CNIF_Network2_ResolveIPAddr(const char *macAddr)
 {
+	CNIJ_NETCACHE_ENTRY entry;
 	int i;
 	CNNET3_ERROR ret = CN_NET3_SUCCEEDED;
 
-	if( SearchSnmp() != CN_NET3_SUCCEEDED ){
+	/* ask the address of the last search directly before searching the whole segment */
+	if( NetCacheLookup( macAddr, &entry ) == 0 ){
+		if( SearchPrinters( entry.ipAddr, WAITTIME_VALIDATE_MILLIS, NULL ) == CN_NET3_SUCCEEDED
+		 && (i = FindNetwork2Dev( macAddr )) >= 0 ){
+			memcpy( ipAddr, network2dev[i].ipAddressStr_, LEN_IP_ADDR );
+			goto onErr1;
+		}
+#ifdef _DEBUG_MODE_
+		fprintf(stderr, "DEBUG: [ResolveIPAddr] %s is no longer at %s\n", macAddr, entry.ipAddr);
+#endif
+	}
+
+	if( SearchSnmp( NULL ) != CN_NET3_SUCCEEDED ){
 		ret = CN_NET3_FAILED;
 		goto onErr1;
 	}
 
-	// int arrayNum = sizeof(network2dev) / sizeof(NETWORK_DEV);
-	i = 0;
+	StoreNetwork2Dev( CNCL_API( GetProtocol ) );
 
-	while( strlen( network2dev[i].modelName_ ) != 0 ) {
-		if( strcmp(macAddr, network2dev[i].macAddressStr_) == 0 ){
-			memcpy( ipAddr, network2dev[i].ipAddressStr_, LEN_IP_ADDR );
+	if( (i = FindNetwork2Dev( macAddr )) >= 0 ){
+		memcpy( ipAddr, network2dev[i].ipAddressStr_, LEN_IP_ADDR );
+	}
+	else{
+		NetCacheRemove( macAddr );
+		ret = CN_NET3_FAILED;
+	}
 
-			ret = CN_NET3_SUCCEEDED;
-			break;
-		}
-		else{
-			ret = CN_NET3_FAILED;
+onErr1:
+	return ret;
+}
+
+
+static int FindNetwork2Dev( const char *macAddr )
+{
+	int i;
+
+	for( i = 0; i < foundNum; i++ ){
+		if( strcmp( macAddr, network2dev[i].macAddressStr_ ) == 0 ){
+			return i;
 		}
+	}
 
-		i++;
+	return -1;
+}
+
+
+/* remember the addresses of the last search for the next job */
+static void StoreNetwork2Dev( CNCL_TYPE_GetProtocol getProtocol )
+{
+	CNIJ_NETCACHE_ENTRY entries[NETWORK_DEV_MAX];
+	int i;
+
+	memset( entries, 0, sizeof(entries) );
+
+	for( i = 0; i < foundNum; i++ ){
+		strncpy( entries[i].macAddr, network2dev[i].macAddressStr_, NETCACHE_MAC_LEN - 1 );
+		strncpy( entries[i].ipAddr, network2dev[i].ipAddressStr_, NETCACHE_IP_LEN - 1 );
+		strncpy( entries[i].modelName, network2dev[i].modelName_, NETCACHE_MODEL_LEN - 1 );
+		if( getProtocol != NULL ){
+			entries[i].protocol = getProtocol( network2dev[i].deviceId_, sizeof(network2dev[i].deviceId_) );
+		}
 	}
 
-onErr1:
-	return ret;
+	NetCacheStore( entries, foundNum );
 }
 
 
 
-int sendData( char *data )
+int sendData( HCNNET3 hnd, char *data )
 {
 	int ret= 0;
 	int i = 0;
@@ -559,7 +652,7 @@ int sendData( char *data )
 #endif
 
 	for( i = 0; i < 10; i++ ){
-		ret = CNIF_Network2_WriteData(data, strlen(data), CNNET3_FALSE);
+		ret = CNIF_Network2_WriteData(hnd, data, strlen(data), CNNET3_FALSE);
 
 #ifdef _DEBUG_MODE_
 		fprintf(stderr, "DEBUG: [CNIF_Network2_WriteData] ret = %d\n", ret);
@@ -580,193 +673,149 @@ EXIT:
 
 
 
-CNNET3_ERROR CNIF_Network2_ReadStatusPrint( unsigned char *buffer, unsigned long bufferSize, size_t *readSize, int isPrinting )
+static HCNNET3 OpenStatusSession( int *result )
 {
-	int						result = CNNET3_FALSE;
-	// char					cmdBuffer[ 1024 ];
-	char					*cmdBuffer;
-	unsigned int			writtenSize;
-	// unsigned char*			data = NULL;
-	char*					data = NULL;
-
-	// unsigned long			size = 0;
-	CNNET3_BOOL				flag = 1;
-	// unsigned char			resBuffer[ CNIJPrinterIvecCommandBufSize ];
-	// unsigned char*			curPtr;
-	unsigned long			total = 0;
-	int						err = 0;
-	char					*library_path = NULL;
-	void					*libclss = NULL;
-
-	char					*xmlBuf_maintenance = NULL;
-	int						xmlBufSize_maintenance = 0;
-	const char				*p_ppd_name = getenv("PPD");
-
-
-	cmdBuffer = (char *) malloc(CNMPU2_SEND_DATA_SIZE);
-
-	if( cmdBuffer != NULL ){
-		memset(cmdBuffer, '\0', CNMPU2_SEND_DATA_SIZE);
-	}
-	else{
-		result = CN_LGMON_OTHER_ERROR;
-		goto EXIT;
-	}
-
-	GetStringWithTagFromFile = NULL;
-
+	HCNNET3		hnd = NULL;
+	int			err = 0;
 
 #ifdef _DEBUG_MODE_
-	fprintf(stderr, "DEBUG: [CNIF_Network2_ReadStatusPrint] Start\n");
 	fprintf(stderr, "DEBUG: [CNNET3_Open] call\n");
 #endif
 
-	chmpWriter = CNNET3_Open();
+	hnd = CNNET3_Open();
 
-	if( chmpWriter == NULL ){
-		result = CN_NET3_CREATE_HND_FAIL;
+	if( hnd == NULL ){
+		*result = CN_NET3_CREATE_HND_FAIL;
 		goto EXIT;
 	}
 
-#ifdef _DEBUG_MODE_
-	fprintf(stderr, "DEBUG: [CNNET3_SetIF] call\n");
-#endif
-
 	// Set I/F
-	err = CNNET3_SetIF( chmpWriter, CNNET3_IFTYPE_HTTP );
+	err = CNNET3_SetIF( hnd, CNNET3_IFTYPE_HTTP );
 
 	if(err != CNNET3_ERR_SUCCESS){
-		result = CN_NET3_SET_CONFIG_FAIL;
+		*result = CN_NET3_SET_CONFIG_FAIL;
 		goto EXIT;
 	}
 
-#ifdef _DEBUG_MODE_
-	fprintf(stderr, "DEBUG: [CNNET3_SetURL] call\n");
-#endif
-
 	// Set URL
-	err = CNNET3_SetURL( chmpWriter, CNNET3_URL_CONTROL );
+	err = CNNET3_SetURL( hnd, CNNET3_URL_CONTROL );
 
 	if(err != CNNET3_ERR_SUCCESS){
-		result = CN_NET3_SET_CONFIG_FAIL;
+		*result = CN_NET3_SET_CONFIG_FAIL;
 		goto EXIT;
 	}
 
-#ifdef _DEBUG_MODE_
-	fprintf(stderr, "DEBUG: [CNNET3_SetIP] call\n");
-#endif
-
 	// Set IP Address
-	err = CNNET3_SetIP( chmpWriter, ipAddr );
+	err = CNNET3_SetIP( hnd, ipAddr );
 
 	if(err != CNNET3_ERR_SUCCESS){
-		result = CN_NET3_SET_CONFIG_FAIL;
+		*result = CN_NET3_SET_CONFIG_FAIL;
 		goto EXIT;
 	}
 
-	library_path = (char *)malloc(CN_LIB_PATH_LEN);
+	return hnd;
 
-	if(library_path == NULL) {
-		result = CN_LGMON_OTHER_ERROR;
-		goto EXIT;
+EXIT:
+	if( hnd != NULL ){
+		CNNET3_Close( hnd );
 	}
 
-	memset(library_path, '\0', CN_LIB_PATH_LEN);
-	snprintf(library_path, CN_LIB_PATH_LEN - 1, CN_CNCL_LIB_PATH, model_number);
-
-	libclss = dlopen(library_path, RTLD_LAZY);
+	return NULL;
+}
 
-	if( ! libclss ){
 
-#ifdef _DEBUG_MODE_
-		fprintf(stderr, "DEBUG: [%s] dlopen failed\n", library_path);
-#endif
-
-		return CN_LGMON_DYNAMID_LINK_ERROR;
-	}
+static char *GetStatusCommand( int isPrinting, int *result )
+{
+	CNCL_TYPE_MakeCommand_GetStatusPrint	makeGetStatus = NULL;
+	CNIJ_CAPCACHE_BLOB		xmlBlob_maintenance = { NULL, 0, NULL, 0 };
+	const char				*p_ppd_name = getenv("PPD");
+	unsigned int			writtenSize;
+	char					*cmdBuffer = NULL;
+	int						err = 0;
 
+	/* the capability of the PPD does not change during the job */
+	if( !statusSession.isCapChecked ){
+		if ( CNCL_API( GetStringWithTagFromFile ) == NULL ) {
+			*result = CN_LGMON_DYNAMID_LINK_ERROR;
+			return NULL;
+		}
 
-	GetStringWithTagFromFile = dlsym( libclss, "CNCL_GetStringWithTagFromFile" );
+		statusSession.hasMaintenance = ( CapCacheGetStringWithTag( CNCL_API( GetStringWithTagFromFile ), p_ppd_name, CNCL_FILE_TAG_CAPABILITY_MAINTENANCE, CNCL_DECODE_EXEC, &xmlBlob_maintenance ) != 0 );
+		statusSession.isCapChecked = 1;
 
-	if ( dlerror() != NULL ) {
-#ifdef _DEBUG_MODE_
-		fprintf(stderr, "DEBUG: [CNCL_GetStringWithTagFromFile] dlsym\n");
-#endif
-		result = CN_LGMON_DYNAMID_LINK_ERROR;
-		goto EXIT;
+		CapCacheRelease( &xmlBlob_maintenance );
 	}
 
-	xmlBufSize_maintenance = GetStringWithTagFromFile( p_ppd_name, CNCL_FILE_TAG_CAPABILITY_MAINTENANCE, (int *)CNCL_DECODE_EXEC, (unsigned char **)&xmlBuf_maintenance );
-
-
-#ifdef _DEBUG_MODE_
-	fprintf(stderr, "DEBUG: [CNCL_MakeCommand_GetStatus] call\n");
-#endif
+	if( !statusSession.hasMaintenance || isPrinting != CNMPU2_TRUE ){
+		cmdBuffer = statusSession.cmdPrint;
+	}
+	else{
+		cmdBuffer = statusSession.cmdMaintenance;
+	}
 
-	// err = CLSS_MakeCommand_GetStatusPrint(NULL, cmdBuffer, sizeof(cmdBuffer), &writtenSize);
+	if( cmdBuffer[0] != '\0' ){
+		return cmdBuffer;
+	}
 
-	if( xmlBufSize_maintenance == 0 || isPrinting != CNMPU2_TRUE ){
 #ifdef _DEBUG_MODE_
-		fprintf(stderr, "DEBUG: [CNCL_MakeCommand_GetStatus] dlsym\n");
+	fprintf(stderr, "DEBUG: [CNCL_MakeCommand_GetStatus] resolve\n");
 #endif
 
-		CNCL_MakeCommand_GetStatus = dlsym(libclss, "CNCL_MakeCommand_GetStatusPrint");
+	if( cmdBuffer == statusSession.cmdPrint ){
+		makeGetStatus = CNCL_API( MakeCommand_GetStatusPrint );
 	}
 	else{
-#ifdef _DEBUG_MODE_
-		fprintf(stderr, "DEBUG: [CNCL_MakeCommand_GetStatus] dlsym\n");
-#endif
-
-		CNCL_MakeCommand_GetStatus = dlsym(libclss, "CNCL_MakeCommand_GetStatusMaintenance");
+		makeGetStatus = CNCL_API( MakeCommand_GetStatusMaintenance );
 	}
 
-	if(dlerror() != NULL){
+	if( makeGetStatus == NULL ){
 
 #ifdef _DEBUG_MODE_
-		fprintf(stderr, "DEBUG: [CNCL_MakeCommand_GetStatus] dlsym failed\n");
+		fprintf(stderr, "DEBUG: [CNCL_MakeCommand_GetStatus] resolve failed\n");
 #endif
-		result = CN_LGMON_DYNAMID_LINK_ERROR;
-		goto EXIT;
+		*result = CN_LGMON_DYNAMID_LINK_ERROR;
+		return NULL;
 	}
 
-	err = CNCL_MakeCommand_GetStatus( cmdBuffer, CNMPU2_SEND_DATA_SIZE, &writtenSize );
-
+	err = makeGetStatus( cmdBuffer, CNMPU2_SEND_DATA_SIZE, &writtenSize );
 
 	if ( err != CN_NET3_SUCCEEDED ) {
 
 #ifdef _DEBUG_MODE_
 		fprintf(stderr, "DEBUG: [ERR] [CNCL_MakeCommand_GetStatus] failed\n");
 #endif
-		result = CN_NET3_MAKE_CMD_FAIL;
-		goto EXIT;
+		cmdBuffer[0] = '\0';
+		*result = CN_NET3_MAKE_CMD_FAIL;
+		return NULL;
 	}
 
-	data = cmdBuffer;
+	return cmdBuffer;
+}
+
+
+static int ExchangeStatus( HCNNET3 hnd, char *data, unsigned char *buffer, unsigned long bufferSize, size_t *readSize )
+{
+	CNNET3_BOOL				flag = 1;
+	unsigned long			total = 0;
+	int						err = 0;
 
 #ifdef _DEBUG_MODE_
 	fprintf(stderr, "DEBUG: [sendData] call\n");
 	fprintf(stderr, "DEBUG: [sendData] data = %s\n", data);
 #endif
 
-	err = sendData( data );
+	err = sendData( hnd, data );
 
 	if ( err != CNNET3_ERR_SUCCESS){
 
 #ifdef _DEBUG_MODE_
 		fprintf(stderr, "DEBUG: [sendData] failed : %d\n", err);
 #endif
-		// errorLine = __LINE__;
-		result = CN_NET3_SEND_DATA_FAIL;
-		goto EXIT;
+		return CN_NET3_SEND_DATA_FAIL;
 	}
 
-	// size = CNIJPrinterIvecCommandBufSize;
-	flag = 1;
-	// curPtr = resBuffer;
-	total = 0;
-
 	while ( flag != 0 ){
-		err = CNNET3_Read( chmpWriter, buffer, &bufferSize, &flag );
+		err = CNNET3_Read( hnd, buffer, &bufferSize, &flag );
 
 #ifdef _DEBUG_MODE_
 		fprintf(stderr, "DEBUG: [CNNET3_Read] err : %d\n", err);
@@ -784,8 +833,7 @@ CNNET3_ERROR CNIF_Network2_ReadStatusPrint( unsigned char *buffer, unsigned long
 #ifdef _DEBUG_MODE_
 			fprintf(stderr, "DEBUG: [CNNET3_Read] failed : %d\n", err);
 #endif
-			result = CN_NET3_READ_DATA_FAIL;
-			goto EXIT;
+			return CN_NET3_READ_DATA_FAIL;
 		}
 
 #ifdef _DEBUG_MODE_
@@ -795,33 +843,56 @@ CNNET3_ERROR CNIF_Network2_ReadStatusPrint( unsigned char *buffer, unsigned long
 
 	*readSize = total;
 
-	result = CNNET3_ERR_SUCCESS;
+	return CNNET3_ERR_SUCCESS;
+}
 
-EXIT:
-	if( chmpWriter != NULL ){
+
+/*
+ * The control channel and the GetStatus commands are made on the first poll
+ * and kept until CNIF_Network2_EndSession, so a poll is one request and its
+ * response. When the exchange fails the channel is opened again once.
+ */
+CNNET3_ERROR CNIF_Network2_ReadStatusPrint( unsigned char *buffer, unsigned long bufferSize, size_t *readSize, int isPrinting )
+{
+	int						result = CNNET3_FALSE;
+	char					*data = NULL;
+	int						retry = 0;
 
 #ifdef _DEBUG_MODE_
-		fprintf(stderr, "DEBUG: [CNNET3_Close] call\n");
+	fprintf(stderr, "DEBUG: [CNIF_Network2_ReadStatusPrint] Start\n");
 #endif
 
-		err = CNNET3_Close(chmpWriter);
+	data = GetStatusCommand( isPrinting, &result );
 
-		chmpWriter = NULL;
+	if( data == NULL ){
+		goto EXIT;
+	}
+
+	for( retry = 0; retry < 2; retry++ ){
+		if( statusSession.hnd == NULL ){
+			statusSession.hnd = OpenStatusSession( &result );
 
-		if( err < 0 ){
-			result = CN_NET3_CLOSE_HND_FAIL;
-			// goto EXIT;
+			if( statusSession.hnd == NULL ){
+				goto EXIT;
+			}
 		}
-	}
 
-	if( cmdBuffer != NULL ){
-		free( cmdBuffer );
-	}
+		result = ExchangeStatus( statusSession.hnd, data, buffer, bufferSize, readSize );
+
+		if( result == CNNET3_ERR_SUCCESS ){
+			break;
+		}
 
-	if ( libclss != NULL ) {
-		dlclose( libclss );
+#ifdef _DEBUG_MODE_
+		fprintf(stderr, "DEBUG: [CNIF_Network2_ReadStatusPrint] reconnect : %d\n", result);
+#endif
+
+		CNNET3_Close( statusSession.hnd );
+		statusSession.hnd = NULL;
 	}
 
+EXIT:
+
 #ifdef _DEBUG_MODE_
 	fprintf(stderr, "DEBUG: [CNIF_Network2_ReadStatusPrint] Exit : %d\n", result);
 #endif
@@ -855,65 +926,90 @@ void DeleteChar( char *s1, char *s2 )
 }
 
 
-int SearchSnmp()
+/* load libcnbpnet20 once for every search of the process */
+static int LoadCnnet2( void )
 {
 	char libPathBuf[CN_LIB_PATH_LEN];
 	void *libcnnet2 = NULL;
-	void *instance = NULL;
-	tagSearchPrinterInfo *infoList = NULL;
-	CNNET2_ERROR_CODE err;
-	unsigned int size = 0;
-	unsigned int i;
-	int num = 0;
-	int ret = CN_NET3_SUCCEEDED;
+	static int isLoaded = CNMPU2_FALSE;
+
+	if ( isLoaded ) {
+		return CN_NET3_SUCCEEDED;
+	}
 
 	strncpy( libPathBuf, CNNET2_LIBNAME, CN_LIB_PATH_LEN );
 	libcnnet2 = dlopen( libPathBuf, RTLD_LAZY );
 
 	if ( !libcnnet2 ) {
-		ret = CN_NET3_FAILED;
-		goto onErr2;
+		return CN_NET3_FAILED;
 	}
 
 	/* Load Symbol */
 	pCNNET2_CreateInstance = dlsym( libcnnet2, "CNNET2_CreateInstance" );
 	if ( dlerror() != NULL ) {
-		ret = CN_NET3_FAILED;
-		goto onErr2;
+		return CN_NET3_FAILED;
 	}
 
 	pCNNET2_DestroyInstance = dlsym( libcnnet2, "CNNET2_DestroyInstance" );
 	if ( dlerror() != NULL ) {
-		ret = CN_NET3_FAILED;
-		goto onErr2;
+		return CN_NET3_FAILED;
 	}
 
 	pCNNET2_OptSetting = dlsym( libcnnet2, "CNNET2_OptSetting" );
 	if ( dlerror() != NULL ) {
-		ret = CN_NET3_FAILED;
-		goto onErr2;
+		return CN_NET3_FAILED;
 	}
 
 	pCNNET2_Search = dlsym( libcnnet2, "CNNET2_Search" );
 	if ( dlerror() != NULL ) {
-		ret = CN_NET3_FAILED;
-		goto onErr2;
+		return CN_NET3_FAILED;
 	}
 
 	pCNNET2_SearchByIpv6 = dlsym( libcnnet2, "CNNET2_SearchByIpv6" );
 	if ( dlerror() != NULL ) {
-		ret = CN_NET3_FAILED;
-		goto onErr2;
+		return CN_NET3_FAILED;
 	}
 
 	pCNNET2_CancelSearch = dlsym( libcnnet2, "CNNET2_CancelSearch" );
 	if ( dlerror() != NULL ) {
-		ret = CN_NET3_FAILED;
-		goto onErr2;
+		return CN_NET3_FAILED;
 	}
 
 	pCNNET2_EnumSearchInfo = dlsym( libcnnet2, "CNNET2_EnumSearchInfo" );
 	if ( dlerror() != NULL ) {
+		return CN_NET3_FAILED;
+	}
+
+	isLoaded = CNMPU2_TRUE;
+	return CN_NET3_SUCCEEDED;
+}
+
+
+/*
+ * Search the NET2 printers into network2dev. With installer, each printer
+ * is printed from the search callback as soon as it answers.
+ */
+int SearchSnmp( int *installer )
+{
+	return SearchPrinters( NULL, WAITTIME_SEARCH_MILLIS, installer );
+}
+
+
+/* broadcast search when ipv4Address is NULL, otherwise ask that address only */
+static int SearchPrinters( const char *ipv4Address, unsigned int timeout, int *installer )
+{
+	void *instance = NULL;
+	tagSearchPrinterInfo *infoList = NULL;
+	CNNET2_ERROR_CODE err;
+	unsigned int size = 0;
+	unsigned int i;
+	int num = 0;
+	int ret = CN_NET3_SUCCEEDED;
+
+	memset( network2dev, 0, sizeof(network2dev) );
+	foundNum = 0;
+
+	if ( LoadCnnet2() != CN_NET3_SUCCEEDED ) {
 		ret = CN_NET3_FAILED;
 		goto onErr2;
 	}
@@ -922,17 +1018,24 @@ int SearchSnmp()
 	instance = pCNNET2_CreateInstance();
 
 	/* Settings for Discovery */
-	err = pCNNET2_OptSetting( instance, CNNET2_SETTING_FLAG_DISCOVER_PRINTER_TIMEOUT_MILLIS, 2000 );
+	err = pCNNET2_OptSetting( instance, CNNET2_SETTING_FLAG_DISCOVER_PRINTER_TIMEOUT_MILLIS, timeout );
 
 	if ( err != CNNET2_ERROR_CODE_SUCCESS ) {
 		ret = CN_NET3_FAILED;
 		goto onErr3;
 	}
 
-	/* Search */
-	num = pCNNET2_Search( instance, NULL, callback_CNNET2_Search, NULL );
+	if ( ipv4Address != NULL ) {
+		err = pCNNET2_OptSetting( instance, CNNET2_SETTING_FLAG_GET_PRINTER_INFO_TIMEOUT_MILLIS, timeout );
+
+		if ( err != CNNET2_ERROR_CODE_SUCCESS ) {
+			ret = CN_NET3_FAILED;
+			goto onErr3;
+		}
+	}
 
-	foundNum = num;
+	/* Search */
+	num = pCNNET2_Search( instance, ipv4Address, callback_CNNET2_Search, installer );
 
 	if ( num < CNNET2_ERROR_CODE_SUCCESS ) {
 		ret = CN_NET3_FAILED;
@@ -971,43 +1074,11 @@ int SearchSnmp()
 	}
 
 	for ( i = 0; i < num; i++ ) {
-		strncpy( network2dev[i].modelName_, infoList[i].modelName_, LEN_MODEL_NAME );
-		strncpy( network2dev[i].ipAddressStr_, infoList[i].ipAddressStr_, LEN_IP_ADDR );
-		snprintf( network2dev[i].macAddressStr_, LEN_MAC_ADDR, "%c%c-%c%c-%c%c-%c%c-%c%c-%c%c",
-				infoList[i].MacAddressStr_[0], infoList[i].MacAddressStr_[1], infoList[i].MacAddressStr_[2], infoList[i].MacAddressStr_[3],
-				infoList[i].MacAddressStr_[4], infoList[i].MacAddressStr_[5], infoList[i].MacAddressStr_[6], infoList[i].MacAddressStr_[7],
-				infoList[i].MacAddressStr_[8], infoList[i].MacAddressStr_[9], infoList[i].MacAddressStr_[10], infoList[i].MacAddressStr_[11] );
-		strncpy( network2dev[i].deviceId_, infoList[i].deviceId_, LEN_DEVICE_ID );
-
-		char	*cnt_cn = NULL;
-		char	*cnt_ser = NULL;
-
-		cnt_cn = strstr( network2dev[i].modelName_, MODEL_CANON );
-		cnt_ser = strstr( network2dev[i].modelName_, MODEL_SERIES );
-
-		if( cnt_cn == NULL || cnt_ser == NULL ){
-			char *cnt_des;
-			char *cnt_colon;
-
-			cnt_des = strstr( infoList[i].deviceId_, MODEL_DES );
-
-			if( cnt_des == NULL ){
-				ret = CN_NET3_FAILED;
-				goto onErr3;
-			}
-			else{
-				cnt_colon = strstr( cnt_des, MODEL_SEMICLN );
-
-				if( cnt_colon == NULL ){
-					ret = CN_NET3_FAILED;
-					goto onErr3;
-				}
-				else{
-					strncpy( network2dev[i].modelName_, cnt_des + sizeof( MODEL_DES ) - 1, strlen( cnt_des ) - strlen( cnt_colon ) - sizeof( MODEL_DES ) + 1 );
-
-				}
-			}
+		if( SetNetworkDev( &network2dev[i], &infoList[i] ) != CN_NET3_SUCCEEDED ){
+			ret = CN_NET3_FAILED;
+			goto onErr3;
 		}
+		foundNum++;
 	}
 
 
@@ -1022,5 +1093,17 @@ onErr2:
 
 static void callback_CNNET2_Search(void *data, const tagSearchPrinterInfo *printerInfo)
 {
+	CNCL_TYPE_GetProtocol	getProtocol = CNCL_API( GetProtocol );
+	NETWORK_DEV				dev;
+
+	if( data == NULL || printerInfo == NULL || getProtocol == NULL ){
+		return;
+	}
+
+	memset( &dev, 0, sizeof(dev) );
+
+	if( SetNetworkDev( &dev, printerInfo ) == CN_NET3_SUCCEEDED ){
+		PrintNetwork2Dev( &dev, *(int *)data, getProtocol );
+	}
 }
 
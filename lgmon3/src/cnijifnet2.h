@@ -42,6 +42,17 @@
 #define CN_NET3_SEND_TIMEOUT	(-9)
 
 #define CNMPU2_SEND_DATA_SIZE	(4096)
+
+/* port 9100 send window, CNNET3_Send sizes grow from START up to the ENV limit */
+#define CNMPU2_SEND_SIZE_ENV		"CNIJ_NET2_SEND_SIZE"	/* bytes, 4096 keeps the old fixed size */
+#define CNMPU2_SEND_SIZE_START		(64 * 1024)
+#define CNMPU2_SEND_SIZE_DEFAULT	(1024 * 1024)
+#define CNMPU2_SEND_SIZE_MAX		(8 * 1024 * 1024)
+#define CNMPU2_SEND_FAST_MSEC		(50)		/* a full chunk sent quicker doubles the size */
+#define CNMPU2_SEND_SLOW_MSEC		(500)		/* a chunk sent slower halves it */
+#define CNMPU2_SEND_TIMEOUT_BASE	(10)		/* sec, client timeout of an empty chunk */
+#define CNMPU2_SEND_TIMEOUT_RATE	(64 * 1024)	/* bytes/sec, the slowest printer the timeout allows for */
+#define CNMPU2_SEND_TIMEOUT_RETRY	(3)			/* timeouts in a row without progress */
 // #define CNMPU2_READ_BUFFER_SIZE (4096)
 #define CNMPU2_READ_BUFFER_SIZE (1024 * 16)
 
@@ -54,6 +65,8 @@
 #define WAITTIME_FIND_PRINTERS	(30)
 #define WAITTIME_START_SESSION	(5)
 #define WAITTIME_RETRY_SEARCH	(30)
+#define WAITTIME_SEARCH_MILLIS		(2000)
+#define WAITTIME_VALIDATE_MILLIS	(1000)	/* unicast query to a cached address */
 
 #define MAX_COUNT_OF_PRINTERS   (64)
 #define STRING_SHORT            (32)
@@ -100,7 +113,7 @@ CNNET3_ERROR CNIF_Network2_Open( const char *_deviceID );
 CNNET3_ERROR CNIF_Network2_StartSession();
 CNNET3_ERROR CNIF_Network2_EndSession();
 // CNNET3_ERROR CNIF_Network2_WriteData( unsigned char *sendBuffer, unsigned long bufferSize, int needContinue );
-CNNET3_ERROR CNIF_Network2_WriteData( char *sendBuffer, unsigned long bufferSize, int needContinue );
+CNNET3_ERROR CNIF_Network2_WriteData( HCNNET3 hnd, char *sendBuffer, unsigned long bufferSize, int needContinue );
 CNNET3_ERROR CNIF_Network2_SendData( unsigned char *sendBuffer, unsigned long bufferSize, size_t *writtenSize );
 // CNNET3_ERROR CNIF_Network2_ReadData(unsigned char **buffer, unsigned long *bufferSize);
 CNNET3_ERROR CNIF_Network2_Discover( int installer );
@@ -111,7 +124,7 @@ CNNET3_ERROR CNIF_Network2_ReadStatusPrint( unsigned char *buffer, unsigned long
 // CNNET3_ERROR CNIF_ReadStatusPrint(unsigned char **buffer, unsigned long *readSize);
 CNNET3_ERROR CNIF_Network2_CancelPrint( char *jobID );
 CNNET3_ERROR CNIF_Network2_SendDummyData();
-int SearchSnmp();
+int SearchSnmp( int *installer );
 // int sendData(unsigned char *data);
-int sendData( char *data );
+int sendData( HCNNET3 hnd, char *data );
 
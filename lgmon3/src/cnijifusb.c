@@ -38,6 +38,7 @@
 #include <unistd.h>
 #include <signal.h>
 #include <poll.h>
+#include <pthread.h>
 
 #include <libusb.h>
 #include "cnijcomif.h"
@@ -56,6 +57,306 @@ static uint8_t g_num[4];									/* [0].configuration; [1].interface [2].rep; [3
 int g_claimed_interface[16] = {0};
 int g_usblp_attached = 0;									/* number of detached interface*/
 
+/*
+ * Asynchronous transfer queue.
+ * CNIF_USB_Write copies the data into a slot and submits it, so several
+ * OUT transfers are in flight while lgmon3 reads the next data. While the
+ * pipe is busy the data is gathered into one slot, which is submitted when
+ * it is full or when the pipe drains. One thread runs the libusb event loop
+ * for the OUT transfers and the status IN transfer.
+ */
+#define CN_USB_SLOT_FREE		(0)
+#define CN_USB_SLOT_FILLING		(1)
+#define CN_USB_SLOT_BUSY		(2)
+
+typedef struct {
+	struct libusb_transfer *transfer;
+	uint8_t *buffer;
+	int length;
+	int state;
+} CN_USB_SLOT;
+
+static CN_USB_SLOT *g_slot = NULL;							/* NULL: synchronous transfer */
+static int g_slot_num = 0;
+static int g_slot_filling = -1;								/* slot gathering the data */
+static int g_busy_num = 0;									/* OUT transfers in flight */
+static int g_async_err = 0;									/* first error of the OUT transfers */
+static struct libusb_transfer *g_in_transfer = NULL;
+static int g_in_done = 0;
+static pthread_t g_event_thread;
+static volatile int g_event_stop = 0;
+static pthread_mutex_t g_queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_queue_cond = PTHREAD_COND_INITIALIZER;
+
+static int CNIF_USB_TransferError(enum libusb_transfer_status status)
+{
+	switch (status) {
+		case LIBUSB_TRANSFER_COMPLETED:
+			return 0;
+		case LIBUSB_TRANSFER_TIMED_OUT:
+			return LIBUSB_ERROR_TIMEOUT;
+		case LIBUSB_TRANSFER_STALL:
+			return LIBUSB_ERROR_PIPE;
+		case LIBUSB_TRANSFER_NO_DEVICE:
+			return LIBUSB_ERROR_NO_DEVICE;
+		case LIBUSB_TRANSFER_OVERFLOW:
+			return LIBUSB_ERROR_OVERFLOW;
+		case LIBUSB_TRANSFER_CANCELLED:
+			return LIBUSB_ERROR_INTERRUPTED;
+		default:
+			break;
+	}
+	return LIBUSB_ERROR_IO;
+}
+
+static void *CNIF_USB_EventThread(void *arg)
+{
+	struct timeval tv;
+	sigset_t mask;
+
+	/* signals are for the main thread */
+	sigfillset(&mask);
+	pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+	while (!g_event_stop) {
+		tv.tv_sec = 0;
+		tv.tv_usec = CN_USB_EVENT_TIMEOUT;
+		libusb_handle_events_timeout_completed(g_context, &tv, NULL);
+	}
+	return NULL;
+}
+
+/* the longest a write or flush waits on the queue, as a synchronous write would */
+static void CNIF_USB_WaitLimit(struct timespec *limit)
+{
+	clock_gettime(CLOCK_REALTIME, limit);
+	limit->tv_sec += CN_WRITE_TIMEOUT / 1000;
+	limit->tv_nsec += (long)(CN_WRITE_TIMEOUT % 1000) * 1000000L;
+	if (limit->tv_nsec >= 1000000000L) {
+		limit->tv_sec++;
+		limit->tv_nsec -= 1000000000L;
+	}
+}
+
+/*
+ * Wait for a transfer to complete, called with g_queue_lock held.
+ * The wait is cut into event timeout steps so that a signal is seen early.
+ * When the limit has passed the transfers in flight are left as they are,
+ * in order, and CNIF_USB_Cancel cancels all of them together.
+ */
+static int CNIF_USB_WaitQueue(const struct timespec *limit)
+{
+	struct timespec ts;
+
+	if (interrupt_sign) {
+		return LIBUSB_ERROR_INTERRUPTED;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	if (ts.tv_sec > limit->tv_sec || (ts.tv_sec == limit->tv_sec && ts.tv_nsec >= limit->tv_nsec)) {
+		return LIBUSB_ERROR_TIMEOUT;
+	}
+
+	ts.tv_nsec += (long)CN_USB_EVENT_TIMEOUT * 1000L;
+	if (ts.tv_nsec >= 1000000000L) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+	if (ts.tv_sec > limit->tv_sec || (ts.tv_sec == limit->tv_sec && ts.tv_nsec > limit->tv_nsec)) {
+		ts = *limit;
+	}
+
+	pthread_cond_timedwait(&g_queue_cond, &g_queue_lock, &ts);
+	return 0;
+}
+
+/* called with g_queue_lock held */
+static int CNIF_USB_SubmitSlot(int index)
+{
+	CN_USB_SLOT *slot = &g_slot[index];
+	int err = 0;
+
+	if (index == g_slot_filling) {
+		g_slot_filling = -1;
+	}
+
+	/*
+	 * No timeout on the transfer itself: libusb would cancel only the one that
+	 * timed out while the later slots go on, and the data would get out of order.
+	 * The wait on the queue is limited instead, see CNIF_USB_WaitQueue.
+	 */
+	libusb_fill_bulk_transfer(slot->transfer, g_dh, g_num[3], slot->buffer, slot->length, slot->transfer->callback, slot, 0);
+	err = libusb_submit_transfer(slot->transfer);
+	if (err < 0) {
+#ifdef _DEBUG_MODE_
+		fprintf(stderr, "ERROR: libusb_submit_transfer Error.(%d)\n", err);
+#endif
+		slot->state = CN_USB_SLOT_FREE;
+		return err;
+	}
+	slot->state = CN_USB_SLOT_BUSY;
+	g_busy_num++;
+
+	return 0;
+}
+
+static void LIBUSB_CALL CNIF_USB_WriteCallback(struct libusb_transfer *transfer)
+{
+	CN_USB_SLOT *slot = (CN_USB_SLOT *)transfer->user_data;
+	int err = 0;
+
+	pthread_mutex_lock(&g_queue_lock);
+
+	if (transfer->status != LIBUSB_TRANSFER_CANCELLED) {
+		err = CNIF_USB_TransferError(transfer->status);
+	}
+
+	if (err < 0 && g_async_err == 0) {
+		g_async_err = err;
+	}
+	slot->state = CN_USB_SLOT_FREE;
+	g_busy_num--;
+
+	/* the pipe has drained, send what has been gathered so far */
+	if (g_busy_num == 0 && g_slot_filling >= 0 && g_async_err == 0) {
+		err = CNIF_USB_SubmitSlot(g_slot_filling);
+		if (err < 0) {
+			g_async_err = err;
+		}
+	}
+	pthread_cond_broadcast(&g_queue_cond);
+	pthread_mutex_unlock(&g_queue_lock);
+}
+
+static void LIBUSB_CALL CNIF_USB_ReadCallback(struct libusb_transfer *transfer)
+{
+	pthread_mutex_lock(&g_queue_lock);
+	g_in_done = 1;
+	pthread_cond_broadcast(&g_queue_cond);
+	pthread_mutex_unlock(&g_queue_lock);
+}
+
+/* drop the queued data and wait for the transfers in flight */
+static void CNIF_USB_QueueCancel()
+{
+	int i;
+
+	pthread_mutex_lock(&g_queue_lock);
+	if (g_slot_filling >= 0) {
+		g_slot[g_slot_filling].state = CN_USB_SLOT_FREE;
+		g_slot_filling = -1;
+	}
+	for (i = 0; i < g_slot_num; i++) {
+		if (g_slot[i].state == CN_USB_SLOT_BUSY) {
+			libusb_cancel_transfer(g_slot[i].transfer);
+		}
+	}
+	while (g_busy_num > 0) {
+		pthread_cond_wait(&g_queue_cond, &g_queue_lock);
+	}
+	g_async_err = 0;
+	pthread_mutex_unlock(&g_queue_lock);
+}
+
+static void CNIF_USB_QueueExit()
+{
+	int i;
+
+	if (g_slot == NULL) {
+		return;
+	}
+
+	CNIF_USB_QueueCancel();
+
+	g_event_stop = 1;
+	pthread_join(g_event_thread, NULL);
+
+	for (i = 0; i < g_slot_num; i++) {
+		if (g_slot[i].transfer != NULL) {
+			libusb_free_transfer(g_slot[i].transfer);
+		}
+		free(g_slot[i].buffer);
+	}
+	if (g_in_transfer != NULL) {
+		libusb_free_transfer(g_in_transfer);
+		g_in_transfer = NULL;
+	}
+	free(g_slot);
+	g_slot = NULL;
+	g_slot_num = 0;
+	g_slot_filling = -1;
+	g_busy_num = 0;
+	g_async_err = 0;
+}
+
+static int CNIF_USB_QueueInit()
+{
+	const char *env = getenv(CN_USB_QUEUE_ENV);
+	int num = CN_USB_QUEUE_NUM;
+	int i;
+
+	if (env != NULL) {
+		num = atoi(env);
+		if (num > CN_USB_QUEUE_NUM_MAX) {
+			num = CN_USB_QUEUE_NUM_MAX;
+		}
+	}
+	if (num <= 0) {
+		return 0;
+	}
+
+	g_slot = (CN_USB_SLOT *)calloc(num, sizeof(CN_USB_SLOT));
+	if (g_slot == NULL) {
+		goto onErr;
+	}
+	g_slot_num = num;
+
+	for (i = 0; i < num; i++) {
+		g_slot[i].buffer = (uint8_t *)malloc(CN_USB_QUEUE_BUF_SIZE);
+		g_slot[i].transfer = libusb_alloc_transfer(0);
+		if (g_slot[i].buffer == NULL || g_slot[i].transfer == NULL) {
+			goto onErr;
+		}
+		g_slot[i].transfer->callback = CNIF_USB_WriteCallback;
+	}
+	g_in_transfer = libusb_alloc_transfer(0);
+	if (g_in_transfer == NULL) {
+		goto onErr;
+	}
+
+	g_event_stop = 0;
+	if (pthread_create(&g_event_thread, NULL, CNIF_USB_EventThread, NULL) != 0) {
+		goto onErr;
+	}
+
+#ifdef _DEBUG_MODE_
+	fprintf(stderr, "DEBUG: usb transfer queue %d x %d\n", num, CN_USB_QUEUE_BUF_SIZE);
+#endif
+	return 0;
+
+onErr:
+	/* fall back to the synchronous transfer */
+#ifdef _DEBUG_MODE_
+	fprintf(stderr, "DEBUG: usb transfer queue was not created\n");
+#endif
+	if (g_slot != NULL) {
+		for (i = 0; i < g_slot_num; i++) {
+			if (g_slot[i].transfer != NULL) {
+				libusb_free_transfer(g_slot[i].transfer);
+			}
+			free(g_slot[i].buffer);
+		}
+		free(g_slot);
+		g_slot = NULL;
+		g_slot_num = 0;
+	}
+	if (g_in_transfer != NULL) {
+		libusb_free_transfer(g_in_transfer);
+		g_in_transfer = NULL;
+	}
+	return CN_USB_WRITE_ERROR;
+}
+
 int CNIF_USB_Open(const char *device_id, CNIF_INFO *if_info)
 {
 	/*-------------define and init parameter --------------*/
@@ -83,7 +384,7 @@ int CNIF_USB_Open(const char *device_id, CNIF_INFO *if_info)
 		goto onErr;
 	}
 	/*-------------search canon printer--------------*/
-	numdev = libusb_get_device_list(NULL, &g_list);
+	numdev = libusb_get_device_list(g_context, &g_list);
 	if((int)numdev == 0) {
 		err = CN_USB_WRITE_ERROR;
 		goto onErr;
@@ -230,6 +531,7 @@ int CNIF_USB_Open(const char *device_id, CNIF_INFO *if_info)
 								goto onErr;
 							}
 							g_num[3] = ep;
+							CNIF_USB_QueueInit();
 							err = 0;
 							goto onErr;
 						}
@@ -259,6 +561,9 @@ int CNIF_USB_Close()
 	int i = 0;
 	int e = 0;
 	
+	/*----------stop transfer queue----------- */
+	CNIF_USB_QueueExit();
+	
 	/*----------free configuration----------- */
 	if(g_cptr != NULL){
 		libusb_free_config_descriptor(g_cptr);
@@ -353,6 +658,30 @@ int CNIF_USB_Reset()
 	return err;
 }
 
+/* the status is read on the event thread, between the queued OUT transfers */
+static int CNIF_USB_ReadAsync(uint8_t *buffer, size_t buffer_size, size_t *read_size)
+{
+	int err = 0;
+
+	pthread_mutex_lock(&g_queue_lock);
+
+	libusb_fill_bulk_transfer(g_in_transfer, g_dh, g_num[2], (unsigned char *)buffer, (int)buffer_size, CNIF_USB_ReadCallback, NULL, CN_WRITE_TIMEOUT);
+	g_in_done = 0;
+	err = libusb_submit_transfer(g_in_transfer);
+	if (err < 0) {
+		goto onErr;
+	}
+	while (!g_in_done) {
+		pthread_cond_wait(&g_queue_cond, &g_queue_lock);
+	}
+	*read_size = g_in_transfer->actual_length;
+	err = CNIF_USB_TransferError(g_in_transfer->status);
+
+onErr:
+	pthread_mutex_unlock(&g_queue_lock);
+	return err;
+}
+
 int CNIF_USB_Read(uint8_t *buffer, size_t buffer_size, size_t *read_size)
 {
 	int err = 0;
@@ -368,7 +697,12 @@ int CNIF_USB_Read(uint8_t *buffer, size_t buffer_size, size_t *read_size)
 	int ret = 1;
 
 	while(1){
-		err = libusb_bulk_transfer(g_dh, g_num[2], (unsigned char *)buffer, buffer_size - 1, (int *)read_size, CN_WRITE_TIMEOUT);
+		if (g_slot != NULL) {
+			err = CNIF_USB_ReadAsync(buffer, buffer_size - 1, read_size);
+		}
+		else {
+			err = libusb_bulk_transfer(g_dh, g_num[2], (unsigned char *)buffer, buffer_size - 1, (int *)read_size, CN_WRITE_TIMEOUT);
+		}
 
 #ifdef _DEBUG_MODE_
 		fprintf(stderr, "DEBUG: [libusb_bulk_transfer] read_size : (%ld)\n", *read_size);
@@ -424,12 +758,103 @@ onErr:
 int CNIF_USB_Write(uint8_t *buffer, size_t buffer_size, size_t *written_size)
 {
 	int err = 0;
-	err = libusb_bulk_transfer(g_dh, g_num[3], (unsigned char *)buffer, (int)buffer_size, (int *)written_size, CN_WRITE_TIMEOUT);
-	
+	int i = 0;
+	size_t size = 0;
+	CN_USB_SLOT *slot = NULL;
+	struct timespec limit;
+
+	if (g_slot == NULL) {
+		err = libusb_bulk_transfer(g_dh, g_num[3], (unsigned char *)buffer, (int)buffer_size, (int *)written_size, CN_WRITE_TIMEOUT);
+		return err;
+	}
+
+	*written_size = 0;
+	CNIF_USB_WaitLimit(&limit);
+	pthread_mutex_lock(&g_queue_lock);
+
+	/* wait for a slot to gather the data */
+	while (g_async_err == 0 && g_slot_filling < 0) {
+		for (i = 0; i < g_slot_num; i++) {
+			if (g_slot[i].state == CN_USB_SLOT_FREE) {
+				g_slot[i].state = CN_USB_SLOT_FILLING;
+				g_slot[i].length = 0;
+				g_slot_filling = i;
+				break;
+			}
+		}
+		if (g_slot_filling < 0 && CNIF_USB_WaitQueue(&limit) < 0) {
+			/* nothing was queued, the caller checks the cancel and retries as after a synchronous timeout */
+			err = LIBUSB_ERROR_TIMEOUT;
+			goto onErr;
+		}
+	}
+	if (g_async_err < 0) {
+		err = g_async_err;
+		goto onErr;
+	}
+
+	slot = &g_slot[g_slot_filling];
+	size = CN_USB_QUEUE_BUF_SIZE - slot->length;
+	if (size > buffer_size) {
+		size = buffer_size;
+	}
+	memcpy(slot->buffer + slot->length, buffer, size);
+	slot->length += size;
+	*written_size = size;
+
+	/* send at once when the pipe is idle, otherwise when the slot is full */
+	if (g_busy_num == 0 || slot->length == CN_USB_QUEUE_BUF_SIZE) {
+		err = CNIF_USB_SubmitSlot(g_slot_filling);
+	}
+
+onErr:
+	pthread_mutex_unlock(&g_queue_lock);
 	return err;
 }
+
+/*
+ * Wait until the queued data has been sent. LIBUSB_ERROR_TIMEOUT is returned
+ * while the printer holds the data, and LIBUSB_ERROR_INTERRUPTED when a signal
+ * came in; the queue is kept so that the caller can call again or cancel.
+ */
+int CNIF_USB_Flush()
+{
+	int err = 0;
+	struct timespec limit;
+
+	if (g_slot == NULL) {
+		return 0;
+	}
+
+	CNIF_USB_WaitLimit(&limit);
+	pthread_mutex_lock(&g_queue_lock);
+	if (g_slot_filling >= 0 && g_async_err == 0) {
+		err = CNIF_USB_SubmitSlot(g_slot_filling);
+	}
+	while (g_busy_num > 0) {
+		int ret = CNIF_USB_WaitQueue(&limit);
+		if (ret < 0) {
+			pthread_mutex_unlock(&g_queue_lock);
+			return ret;
+		}
+	}
+	if (err == 0) {
+		err = g_async_err;
+	}
+	g_async_err = 0;
+	pthread_mutex_unlock(&g_queue_lock);
+
+#ifdef _DEBUG_MODE_
+	fprintf(stderr, "DEBUG: usb transfer queue flushed(%d)\n", err);
+#endif
+	return err;
+}
+
 int CNIF_USB_Cancel()
 {
+	if (g_slot != NULL) {
+		CNIF_USB_QueueCancel();
+	}
 	CNIF_USB_Reset();
 	return 0;
 }
@@ -586,7 +1011,7 @@ int CNIF_USB_Discover()
 							memset(dev_uri, 0, sizeof(dev_uri));
 							snprintf(dev_uri, sizeof(dev_uri), "direct cnijbe2://Canon/?port=usb&serial=%s \"%s\" \"USB Printer #%d with status readback for Canon IJ\"", serial, value, ++n);
 
-							fprintf(stdout, "%s\n", dev_uri);
+							CNIF_PrintDevice("usb", serial, "%s\n", dev_uri);
 						}
 					}
 				}
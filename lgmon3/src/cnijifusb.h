@@ -46,12 +46,20 @@
 #define CN_USB_PRINTER_WRITE_EP (1)
 #define CN_USB_PRINTER_READ_EP (2)
 
+/*-------Transfer Queue--------------*/
+#define CN_USB_QUEUE_ENV			("CNIJ_USB_QUEUE_NUM")	/* 0: synchronous transfer */
+#define CN_USB_QUEUE_NUM			(4)
+#define CN_USB_QUEUE_NUM_MAX		(32)
+#define CN_USB_QUEUE_BUF_SIZE		(256 * 1024)
+#define CN_USB_EVENT_TIMEOUT		(100 * 1000)			/* usec */
+
 int CNIF_USB_Open(const char *device_id, CNIF_INFO *if_info);
 int CNIF_USB_Close();
 int CNIF_USB_OneDeviceClose();
 int CNIF_USB_Reset();
 int CNIF_USB_Read(uint8_t *buffer, size_t bufferSize, size_t *readSize);
 int CNIF_USB_Write(uint8_t *buffer, size_t bufferSize, size_t *writtenSize);
+int CNIF_USB_Flush();
 int CNIF_USB_Cancel();
 int CNIF_USB_Discover();
 int CNIF_USB_SearchEndpoint(int type);
@@ -39,23 +39,71 @@
 #include "cnclcmdutils.h"
 #include "./common/libcnnet3_type.h"
 #include "cnijifnet2.h"
-
-int (*CNCL_GetString)(const char*, const char*, int, uint8_t**);
+#include "cnijcncl.h"
 
 static char	uuid[UUID_LEN + 1];
-static int	isPrinting = CNNET3_FALSE;
 static int	isCanceled = CNNET3_FALSE;
-static char	_jobID[10] = "";
 static int	prot = 0;
 
 // #define _DEBUG_MODE_
 
 int interrupt_sign = 0;
-int (*GET_RESPONSE)(char *, int, int *, char *, int **);
-int (*GET_STATUS)(char *, int, int *, int * , char *);
-int (*GET_STATUS2)(char *, int, char *, int *, int * , char *, char *);
-int (*GET_STATUS2_MAINTENANCE)(char *, int, char *, int *, int * , char *, char *);
-int (*GET_PROTOCOL)(char *, size_t);
+
+/*
+ * Status monitor
+ * While the data is sent, the printer status is polled on its own thread,
+ * so a write never waits for a status round trip. The thread publishes the
+ * last result as a snapshot guarded by a sequence counter, which the writer
+ * copies without taking a lock. The main thread only talks to the printer
+ * itself while the monitor is stopped.
+ */
+typedef struct {
+	int response;		/* last CNIF_GetResponse result */
+	int isCancel;		/* the printer has started canceling the job */
+	int isError;		/* the last poll could not read the status */
+	int isPrinting;		/* the printer has reported a job ID */
+	char jobID[CN_IVEC_JOBID_LEN + 1];
+	unsigned int count;	/* number of polls */
+} STATUS_SNAPSHOT;
+
+static STATUS_SNAPSHOT	statmon_snapshot;
+static unsigned int		statmon_seq = 0;
+static pthread_t		statmon_thread;
+static pthread_mutex_t	statmon_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	statmon_cond = PTHREAD_COND_INITIALIZER;
+static int				statmon_running = 0;
+static int				statmon_stop = 0;
+static CNIF_INFO		*statmon_if_info = NULL;
+static int				statmon_isMaintenance = CNNET3_FALSE;
+
+/* buffers of CNIF_GetResponse, allocated on the first call */
+static char		*resp_supportID = NULL;
+static char		*resp_stat_msg = NULL;
+static char		*resp_stat_tmp_msg = NULL;
+static char		*resp_cmdBuffer = NULL;
+static size_t	resp_cmdBufferSize = 0;
+static char		*resp_cmdBuffer_big = NULL;
+static char		*resp_tmpBuffer_big = NULL;
+static char		*resp_jobId = NULL;
+
+static int StatusMonitorStart(CNIF_INFO *if_info, int isMaintenance);
+static void StatusMonitorStop(void);
+static void StatusMonitorGet(STATUS_SNAPSHOT *snapshot);
+static void StatusMonitorMerge(const STATUS_SNAPSHOT *snapshot, int *isPrinting, char *job_id);
+#define GET_RESPONSE			CNCL_API( GetInfoResponse )
+#define GET_STATUS				CNCL_API( GetStatus )
+#define GET_STATUS2				CNCL_API( GetStatus2 )
+#define GET_STATUS2_MAINTENANCE	CNCL_API( GetStatus_Maintenance )
+#define GET_PROTOCOL			CNCL_API( GetProtocol )
+
+/* entry points the status loop calls, checked before the job starts */
+static const int cnclRequired[] = {
+	CNCL_ID_GetInfoResponse,
+	CNCL_ID_GetStatus,
+	CNCL_ID_GetProtocol,
+	CNCL_ID_GetStatus2,
+	CNCL_ID_GetStatus_Maintenance,
+};
 
 
  int main(int argc, char *argv[])
@@ -66,7 +114,7 @@ int (*GET_PROTOCOL)(char *, size_t);
 
 	/*--------------param setting-----------------*/
 	CNIF_INFO if_info;
-	FILE *fp = stdin;
+	int fd = STDIN_FILENO;
 	//ppd_file_t *ppd;
 	//ppd_attr_t *attr;
 	int err = 0;
@@ -76,15 +124,19 @@ int (*GET_PROTOCOL)(char *, size_t);
 	int response_detail = 0;
 	size_t transfered_data = 0;
 	size_t readed_data = 0;
+	size_t block_size = 0;
+	int read_err = 0;
+	int read_eof = 0;
 	// char *cmd_buffer = NULL;
 	char *write_buffer = NULL;
 	char *job_id = NULL;
 	char *temp_job = NULL;
 	char *dev_uri = NULL;
 	char *deviceID = NULL;
-	char *library_path = NULL;
-	char model_number[] = "com2";
 	int isFirst;
+	int isPrinting = CNNET3_FALSE;
+	STATUS_SNAPSHOT status;
+	WAIT_POLICY wait;
 
 	char *serviceType = getenv("CONTENT_TYPE");
 
@@ -110,7 +162,7 @@ int (*GET_PROTOCOL)(char *, size_t);
 	// 	goto onErr;
 	// }
 
-	write_buffer = (char *)malloc(CN_WRITE_SIZE);
+	write_buffer = AllocReadBlock(&block_size);
 	if(write_buffer == NULL) {
 		err = CN_LGMON_OTHER_ERROR;
 		goto onErr;
@@ -140,19 +192,11 @@ int (*GET_PROTOCOL)(char *, size_t);
 		goto onErr;
 	}
 
-	library_path = (char *)malloc(CN_LIB_PATH_LEN);
-	if(library_path == NULL) {
-		err = CN_LGMON_OTHER_ERROR;
-		goto onErr;
-	}
-
 	// memset(cmd_buffer, 		'\0', CN_READ_SIZE);
-	memset(write_buffer, 	'\0', CN_WRITE_SIZE);
 	memset(job_id, 			'\0', CN_IVEC_JOBID_LEN);
 	memset(temp_job, 		'\0', CN_IVEC_JOBID_LEN);
 	memset(dev_uri, 		'\0', CN_DEVICE_URI_LEN);
 	memset(deviceID, 		'\0', CN_DEVICE_ID_LEN);
-	memset(library_path, 	'\0', CN_LIB_PATH_LEN);
 
 	CNIF_SetSignal(CN_SIGTERM);
 	/*--------------switch option(argv[])-----------------*/
@@ -218,71 +262,11 @@ int (*GET_PROTOCOL)(char *, size_t);
 	}
 
 	/* read the file data before tansferdata */
-	readed_data = fread(write_buffer, sizeof(char), CN_WRITE_SIZE, fp);
+	read_err = ReadBlock(fd, write_buffer, block_size, &readed_data, &read_eof);
 
 
 	/*---------------dynamic link of library---------------------*/
-	void *libclss = NULL;
-
-	snprintf(library_path, CN_LIB_PATH_LEN - 1, CN_CNCL_LIB_PATH, model_number);
-
-#ifdef _DEBUG_MODE_
-	fprintf(stderr, "DEBUG: progpath = %s\n", library_path);
-#endif
-
-	libclss = dlopen(library_path, RTLD_LAZY);
-	if(!libclss){
-
-#ifdef _DEBUG_MODE_
-		fprintf(stderr, "ERROR: dynamic link error.(%s)", dlerror());
-#endif
-		return CN_LGMON_DYNAMID_LINK_ERROR;
-	}
-
-	GET_RESPONSE = dlsym(libclss, "CNCL_GetInfoResponse");
-	if(dlerror() != NULL){
-
-#ifdef _DEBUG_MODE_
-		fprintf(stderr, "DEBUG: cannnot find function2.(%s)", dlerror());
-#endif
-		return CN_LGMON_DYNAMID_LINK_ERROR;
-	}
-	GET_STATUS = dlsym(libclss, "CNCL_GetStatus");
-	if(dlerror() != NULL){
-
-#ifdef _DEBUG_MODE_
-		fprintf(stderr, "DEBUG: cannnot find function3.(%s)", dlerror());
-#endif
-		return CN_LGMON_DYNAMID_LINK_ERROR;
-	}
-
-	GET_PROTOCOL = dlsym(libclss, "CNCL_GetProtocol");
-	if(dlerror() != NULL){
-
-#ifdef _DEBUG_MODE_
-		fprintf(stderr, "DEBUG: cannnot find function4.(%s)", dlerror());
-#endif
-
-		return CN_LGMON_DYNAMID_LINK_ERROR;
-	}
-
-	GET_STATUS2 = dlsym(libclss, "CNCL_GetStatus2");
-	if(dlerror() != NULL){
-
-#ifdef _DEBUG_MODE_
-		fprintf(stderr, "DEBUG: cannnot find function5.(%s)", dlerror());
-#endif
-
-		return CN_LGMON_DYNAMID_LINK_ERROR;
-	}
-
-	GET_STATUS2_MAINTENANCE = dlsym(libclss, "CNCL_GetStatus_Maintenance");
-	if(dlerror() != NULL){
-
-#ifdef _DEBUG_MODE_
-		fprintf(stderr, "DEBUG: cannnot find function6.(%s)", dlerror());
-#endif
-
+	if(CnclRequire(cnclRequired, sizeof(cnclRequired) / sizeof(cnclRequired[0])) != 0){
 		return CN_LGMON_DYNAMID_LINK_ERROR;
 	}
 
@@ -352,6 +336,7 @@ int (*GET_PROTOCOL)(char *, size_t);
 		fprintf(stderr, "DEBUG: [CNIF_Open] Call\n");
 #endif
 
+	InitWaitPolicy(&wait, CN_WAIT_OPEN_FIRST, CN_WAIT_OPEN_MAX);
 	do {
 		err = CNIF_Open(deviceID, &if_info);
 
@@ -361,7 +346,10 @@ int (*GET_PROTOCOL)(char *, size_t);
 
 		if(err < 0) {
 			fprintf(stderr, "INFO: %s\n", LookupText( "LBM_PREPARING" ));
-			sleep(30);
+			if(WaitWithPolicy(&wait, &interrupt_sign)){
+				fprintf(stderr, "INFO: \n");
+				goto onErr;
+			}
 		}
 	} while (err < 0);
 
@@ -370,13 +358,14 @@ int (*GET_PROTOCOL)(char *, size_t);
 		fprintf(stderr, "DEBUG: [CNIF_GetResponse] Call\n");
 #endif
 
-	err = CNIF_GetResponse(&if_info, temp_job, &response_detail, CNNET3_FALSE);
+	err = CNIF_GetResponse(&if_info, temp_job, &response_detail, CNNET3_FALSE, &isPrinting);
 	if(err < 0) {
 		err = CN_LGMON_RESPONSE_ERROR;
 		goto onErr;
 	}
 
 	/*---------------check printer status----------------------*/
+	InitWaitPolicy(&wait, CN_WAIT_IDLE_FIRST, CN_WAIT_IDLE_MAX);
 	while(1) {
 		/* check intterrupt signal */
 		if(interrupt_sign == 1){
@@ -384,12 +373,12 @@ int (*GET_PROTOCOL)(char *, size_t);
 			goto onErr;
 		}
 
-		err = CNIF_GetResponse(&if_info, temp_job, &response_detail, CNNET3_FALSE);
+		err = CNIF_GetResponse(&if_info, temp_job, &response_detail, CNNET3_FALSE, &isPrinting);
 
 		if (err >= 0) {
 			// if( err != CN_IVEC_STATUS_IDLE ) {
 			if( err != CN_IVEC_STATUS_IDLE && err != CLSS_OK_AND_IDLE && err != CLSS_NOT_SUPP_AND_IDLE ) {
-				sleep(1);
+				WaitWithPolicy(&wait, &interrupt_sign);
 				continue;
 			}
 			break;
@@ -401,6 +390,7 @@ int (*GET_PROTOCOL)(char *, size_t);
 
 	fprintf(stderr, "DEBUG: session start\n");
 	/*--------------start session-----------------*/
+	InitWaitPolicy(&wait, CN_WAIT_BUSY_FIRST, CN_WAIT_BUSY_MAX);
 	while (1){
 		/* check intterrupt signal */
 		if(interrupt_sign == 1){
@@ -429,11 +419,11 @@ int (*GET_PROTOCOL)(char *, size_t);
 		else
 		{
 			// display status
-			err = CNIF_GetResponse(&if_info, temp_job, &response_detail, CNNET3_FALSE);
+			err = CNIF_GetResponse(&if_info, temp_job, &response_detail, CNNET3_FALSE, &isPrinting);
 
 			// device is busy
 			// fprintf(stderr, "INFO: %s\n", LookupText( "LBM_BUSY" ));
-			sleep(4);
+			WaitWithPolicy(&wait, &interrupt_sign);
 			continue;
 		}
 	}
@@ -451,31 +441,48 @@ int (*GET_PROTOCOL)(char *, size_t);
 
 	int flgSendStart = CNNET3_FALSE;
 
+	/* the legacy NET library shares one handle for the data and the status, so it is polled inline */
+	if( if_info.ifType == CNIF_TYPE_USB || if_info.ifType == CNIF_TYPE_NET2 ){
+		StatusMonitorStart(&if_info, ( strncmp( serviceType, SVC_MAINTENANCE, sizeof(SVC_MAINTENANCE) )  == 0 ) ? CNNET3_TRUE : CNNET3_FALSE);
+	}
+
 	while(copies > 0) {
 		copies--;
 
 		while(sign) {
 			max_read_size = readed_data;
 
-			if (readed_data < CN_WRITE_SIZE) {
-				if (feof(fp)) {
-					sign = 0;	//EOF
-				}
-				if (ferror(fp)) {
+			if (read_eof) {
+				sign = 0;	//EOF
+			}
+			if (read_err < 0) {
 #ifdef _DEBUG_MODE_
-					fprintf(stderr, "ERROR: fread error\n");//ERROR_MSG
+				fprintf(stderr, "ERROR: read error\n");//ERROR_MSG
 #endif
-					err = CN_LGMON_OTHER_ERROR;
-					goto onErr;
-				}
+				err = CN_LGMON_OTHER_ERROR;
+				goto onErr;
 			}
 
 			/* transfer data to printer */
 			for( ; readed_data != 0; readed_data -= transfered_data) {
-				time(&end_time);
-				past_sec = difftime(end_time, start_time);
+				if(statmon_running){
+					StatusMonitorGet(&status);
+					StatusMonitorMerge(&status, &isPrinting, temp_job);
+
+					if(status.isCancel && isCanceled != CNMPU2_TRUE){
+						interrupt_sign = 1;
+						isCanceled = CNMPU2_TRUE;
+#ifdef _DEBUG_MODE_
+						fprintf(stderr, "ERROR: Response CN_IVEC_STATUS_CANCELING(%d)\n", status.response);
+#endif
+					}
+				}
+				else {
+					time(&end_time);
+					past_sec = difftime(end_time, start_time);
+				}
 
-				if(past_sec >= 4){
+				if(!statmon_running && past_sec >= CN_STATUS_INTERVAL){
 					time(&start_time);
 
 #ifdef _DEBUG_MODE_
@@ -483,10 +490,10 @@ int (*GET_PROTOCOL)(char *, size_t);
 #endif
 
 					if ( strncmp( serviceType, SVC_MAINTENANCE, sizeof(SVC_MAINTENANCE) )  == 0 ){
-						err = CNIF_GetResponse(&if_info, temp_job, &response_detail, CNNET3_TRUE);
+						err = CNIF_GetResponse(&if_info, temp_job, &response_detail, CNNET3_TRUE, &isPrinting);
 					}
 					else{
-						err = CNIF_GetResponse(&if_info, temp_job, &response_detail, CNNET3_FALSE);
+						err = CNIF_GetResponse(&if_info, temp_job, &response_detail, CNNET3_FALSE, &isPrinting);
 					}
 
 					if(err == CN_IVEC_STATUS){
@@ -547,6 +554,12 @@ int (*GET_PROTOCOL)(char *, size_t);
 					//reset and close printer
 
 					if( if_info.ifType == CNIF_TYPE_USB || if_info.ifType == CNIF_TYPE_NET2 ){
+						/* CNIF_Cancel must not race a status poll of the monitor */
+						if( isCanceled == CNMPU2_TRUE ){
+							StatusMonitorStop();
+							StatusMonitorGet(&status);
+							StatusMonitorMerge(&status, &isPrinting, temp_job);
+						}
 						if( isPrinting == CNMPU2_TRUE && isCanceled == CNMPU2_TRUE ){
 							CNIF_Cancel(&if_info);
 							err = CN_LGMON_OK;
@@ -563,6 +576,7 @@ int (*GET_PROTOCOL)(char *, size_t);
 					// else if( if_info.ifType == CNIF_TYPE_USB || if_info.ifType == CNIF_TYPE_NET ){
 					else if( if_info.ifType == CNIF_TYPE_NET ){
 						//reset and close printer
+						StatusMonitorStop();
 						err = CNIF_Cancel(&if_info);
 						err = CN_LGMON_OK;
 						fprintf(stderr, "INFO: \n");
@@ -573,10 +587,30 @@ int (*GET_PROTOCOL)(char *, size_t);
 			times++;
 
 			/* read the file data */
-			memset(write_buffer, '\0', CN_WRITE_SIZE);
-			readed_data = fread(write_buffer, sizeof(char), CN_WRITE_SIZE, fp);
+			if (sign) {
+				read_err = ReadBlock(fd, write_buffer, block_size, &readed_data, &read_eof);
+			}
 		};
 	}
+
+	/* wait for the queued data, a printer out of paper holds it until the job is resumed or cancelled */
+	while( (err = CNIF_Flush(&if_info)) == CN_LGMON_BUSY ){
+		if( interrupt_sign == 1 ){
+			StatusMonitorStop();
+			CNIF_Cancel(&if_info);
+			err = CN_LGMON_OK;
+			fprintf(stderr, "INFO: \n");
+			goto onErr;
+		}
+	}
+	StatusMonitorStop();
+	StatusMonitorGet(&status);
+	StatusMonitorMerge(&status, &isPrinting, temp_job);
+	if(err < 0) {
+		fprintf(stderr, "INFO: %s\n", LookupText( "LBM_CANT_COMM_PRINT" ));
+		err = CN_LGMON_WRITEDATA_ERROR;
+		goto onErr;
+	}
 #ifdef _DEBUG_MODE_
 	fprintf(stderr, "DEBUG: all data sended\n");
 #endif
@@ -589,8 +623,10 @@ int (*GET_PROTOCOL)(char *, size_t);
 	time(&start_time2);
 
 
+	InitWaitPolicy(&wait, CN_WAIT_DONE_FIRST, CN_WAIT_DONE_MAX);
+
 	if ( strncmp( serviceType, SVC_MAINTENANCE, sizeof(SVC_MAINTENANCE) )  == 0 ){
-		sleep(2);
+		WaitWithPolicy(&wait, &interrupt_sign);
 	}
 
 	/*------------check printer status-----------*/
@@ -626,10 +662,10 @@ int (*GET_PROTOCOL)(char *, size_t);
 				}
 
 				if ( strncmp( serviceType, SVC_MAINTENANCE, sizeof(SVC_MAINTENANCE) )  == 0 ){
-					err = CNIF_GetResponse(&if_info, temp_job, &response_detail, CNNET3_TRUE);
+					err = CNIF_GetResponse(&if_info, temp_job, &response_detail, CNNET3_TRUE, &isPrinting);
 				}
 				else{
-					err = CNIF_GetResponse(&if_info, temp_job, &response_detail, CNNET3_FALSE);
+					err = CNIF_GetResponse(&if_info, temp_job, &response_detail, CNNET3_FALSE, &isPrinting);
 				}
 
 #ifdef _DEBUG_MODE_
@@ -644,7 +680,7 @@ int (*GET_PROTOCOL)(char *, size_t);
 						goto onErr;
 	                }
 
-					sleep(4);
+					WaitWithPolicy(&wait, &interrupt_sign);
 					continue;
 	            }
 				else if ( strncmp( serviceType, SVC_MAINTENANCE, sizeof(SVC_MAINTENANCE) )  == 0 &&
@@ -659,7 +695,7 @@ int (*GET_PROTOCOL)(char *, size_t);
 					break;
 				}
 				else{
-					sleep(4);
+					WaitWithPolicy(&wait, &interrupt_sign);
 					continue;
 				}
 			}
@@ -669,7 +705,7 @@ int (*GET_PROTOCOL)(char *, size_t);
 		}
 		else if( if_info.ifType == CNIF_TYPE_USB || if_info.ifType == CNIF_TYPE_NET ){
 			if ( isFirst ) {
-				sleep(2);
+				WaitWithPolicy(&wait, &interrupt_sign);
 				isFirst = 0;
 			}
 			/* check intterrupt signal */
@@ -678,10 +714,10 @@ int (*GET_PROTOCOL)(char *, size_t);
 				goto onErr;
 			}
 
-			err = CNIF_GetResponse(&if_info, temp_job, &response_detail, CNNET3_FALSE);
+			err = CNIF_GetResponse(&if_info, temp_job, &response_detail, CNNET3_FALSE, &isPrinting);
 			if (err >= 0) {
 				if(err != CN_IVEC_STATUS_IDLE) {
-					sleep(4);
+					WaitWithPolicy(&wait, &interrupt_sign);
 					continue;
 				}
 				break;
@@ -691,11 +727,6 @@ int (*GET_PROTOCOL)(char *, size_t);
 			}
 		}
 	}
-	/*-----------close dynamic link--------------*/
-	if(libclss != NULL){
-		dlclose(libclss);
-	}
-	
 	fprintf(stderr, "INFO: \n");
 	goto OK;
 	
@@ -704,6 +735,7 @@ onErr:
 		err = 1;
 	}
 	
+	StatusMonitorStop();
 	CNIF_Reset(&if_info);
 	
 OK:
@@ -720,9 +752,9 @@ OK:
 	free(temp_job);
 	free(dev_uri);
 	free(deviceID);
-	free(library_path);
 	//free(model_number);
 	
+	CNIF_FreeResponseBuffer();
 	FreeKeyTextList();
 	FreeKeyTextDir();
 	
@@ -761,7 +793,11 @@ void CNIF_SigCatch(int sign)
 	isCanceled = CNMPU2_TRUE;
 }
 
-int CNIF_GetResponse(CNIF_INFO *if_info, char *job_id, int *response_detail, int isMaintenance)
+/*
+ * Poll the printer status once. job_id and isPrinting are only set when
+ * the printer reports the job, the caller owns both.
+ */
+int CNIF_GetResponse(CNIF_INFO *if_info, char *job_id, int *response_detail, int isMaintenance, int *isPrinting)
 {
 	/*---------------define parameter-------------------------*/
     int err = 0;
@@ -777,64 +813,46 @@ int CNIF_GetResponse(CNIF_INFO *if_info, char *job_id, int *response_detail, int
 	char *stat_tmp_msg = NULL;
 	char *cmdBuffer = NULL;
 	char *cmdBuffer_big = NULL;
-	char *tmpBuffer = NULL;
 	char *tmpBuffer_big = NULL;
 	char *jobId = NULL;
+	char statusJobID[CN_IVEC_JOBID_LEN + 1];
 
 	/*---------------init parameter-------------------------*/
-	supportID = (char *)malloc(CN_IVEC_SUPPORT_CODE_LENGTH);
-	if(supportID == NULL){
-		err = -1;
-		goto onErr;
-	}
-	
-	stat_msg = (char *)malloc(CN_STAT_MSG_LEN);
-	if(stat_msg == NULL){
-		err = -1;
-		goto onErr;
-	}
-	
-	stat_tmp_msg = (char *)malloc(CN_STAT_MSG_LEN);
-	if(stat_tmp_msg == NULL){
-		err = -1;
-		goto onErr;
-	}
-
-	cmdBuffer = (char *)malloc(CN_READ_SIZE);
-	if(cmdBuffer == NULL){
-		err = -1;
-		goto onErr;
-	}
-
-	cmdBuffer_big = (char *)malloc(CN_READ_SIZE_BIG);
-	if(cmdBuffer_big == NULL){
-		err = -1;
-		goto onErr;
-	}
-
-	tmpBuffer = (char *)malloc(CN_READ_SIZE);
-	if(tmpBuffer == NULL){
-		err = -1;
-		goto onErr;
-	}
-
-	tmpBuffer_big = (char *)malloc(CN_READ_SIZE_BIG);
-	if(tmpBuffer_big == NULL){
-		err = -1;
-		goto onErr;
-	}
-
-	jobId = (char *)malloc(CN_IVEC_JOBID_LEN);
-	if(jobId == NULL){
-		err = -1;
-		goto onErr;
+	/*
+	 * The buffers are kept for the next call. Only one thread may call this
+	 * at a time: the main thread before StatusMonitorStart and after
+	 * StatusMonitorStop, the status monitor in between.
+	 */
+	memset(statusJobID, '\0', sizeof(statusJobID));
+	if(resp_jobId == NULL){
+		resp_supportID = (char *)malloc(CN_IVEC_SUPPORT_CODE_LENGTH);
+		resp_stat_msg = (char *)malloc(CN_STAT_MSG_LEN);
+		resp_stat_tmp_msg = (char *)malloc(CN_STAT_MSG_LEN);
+		resp_cmdBuffer = (char *)malloc(CN_READ_SIZE);
+		resp_cmdBufferSize = CN_READ_SIZE;
+		resp_cmdBuffer_big = (char *)malloc(CN_READ_SIZE_BIG);
+		resp_tmpBuffer_big = (char *)malloc(CN_READ_SIZE_BIG);
+		resp_jobId = (char *)malloc(CN_IVEC_JOBID_LEN);
+
+		if(resp_supportID == NULL || resp_stat_msg == NULL || resp_stat_tmp_msg == NULL || resp_cmdBuffer == NULL ||
+		   resp_cmdBuffer_big == NULL || resp_tmpBuffer_big == NULL || resp_jobId == NULL){
+			CNIF_FreeResponseBuffer();
+			err = -1;
+			goto onErr;
+		}
 	}
+	supportID = resp_supportID;
+	stat_msg = resp_stat_msg;
+	stat_tmp_msg = resp_stat_tmp_msg;
+	cmdBuffer = resp_cmdBuffer;
+	cmdBuffer_big = resp_cmdBuffer_big;
+	tmpBuffer_big = resp_tmpBuffer_big;
+	jobId = resp_jobId;
 
 
 	memset(jobId, 		'\0', CN_IVEC_JOBID_LEN);
-	memset(cmdBuffer, 	'\0', CN_READ_SIZE);
+	memset(cmdBuffer, 	'\0', resp_cmdBufferSize);
 	memset(cmdBuffer_big, 	'\0', CN_READ_SIZE_BIG);
-	memset(tmpBuffer, 	'\0', CN_READ_SIZE);
 	memset(tmpBuffer_big, 	'\0', CN_READ_SIZE_BIG);
 	memset(supportID, 	'\0', CN_IVEC_SUPPORT_CODE_LENGTH);
 	memset(stat_msg, 	'\0', CN_STAT_MSG_LEN);
@@ -842,7 +860,7 @@ int CNIF_GetResponse(CNIF_INFO *if_info, char *job_id, int *response_detail, int
 
 
 	/*---------------get printer state info-------------------------*/
-    int i = 1;
+    int i = resp_cmdBufferSize / CN_READ_SIZE;
     while(1) {
 		if ( if_info->ifType == CNIF_TYPE_USB ){
 			read_size = 0;
@@ -872,12 +890,14 @@ int CNIF_GetResponse(CNIF_INFO *if_info, char *job_id, int *response_detail, int
 
 				i = i + 1;
 
-				cmdBuffer = (char *)realloc(cmdBuffer, i * CN_READ_SIZE);
+				cmdBuffer = (char *)realloc(resp_cmdBuffer, i * CN_READ_SIZE);
 
 				if (cmdBuffer == NULL) {
 					err = -1;
 					goto onErr;
 				} else {
+					resp_cmdBuffer = cmdBuffer;
+					resp_cmdBufferSize = i * CN_READ_SIZE;
 					memset( cmdBuffer, '\0', CN_READ_SIZE * i );
 				}
 
@@ -955,14 +975,14 @@ int CNIF_GetResponse(CNIF_INFO *if_info, char *job_id, int *response_detail, int
 
 		if( strncmp( serviceType, typePtnMaintenance, sizeof(typePtnMaintenance) )  == 0 &&
             isMaintenance == CNNET3_TRUE ){
-			err = GET_STATUS2_MAINTENANCE( cmdBuffer_big, sumsize, uuid, &status, &statusDetail, supportID, _jobID );
+			err = GET_STATUS2_MAINTENANCE( cmdBuffer_big, sumsize, uuid, &status, &statusDetail, supportID, statusJobID );
 
 #ifdef _DEBUG_MODE_
 			fprintf(stderr, "DEBUG: GET_STATUS2_MAINTENANCE : %d\n", err);
 #endif
 		}
 		else{
-			err = GET_STATUS2( cmdBuffer_big, sumsize, uuid, &status, &statusDetail, supportID, _jobID );
+			err = GET_STATUS2( cmdBuffer_big, sumsize, uuid, &status, &statusDetail, supportID, statusJobID );
 
 #ifdef _DEBUG_MODE_
 			fprintf(stderr, "DEBUG: GET_STATUS2 : %d\n", err);
@@ -970,12 +990,12 @@ int CNIF_GetResponse(CNIF_INFO *if_info, char *job_id, int *response_detail, int
 		}
 
 
-		if( err == CLSS_OK && _jobID[0] != 0x00 ){
-			isPrinting = CNMPU2_TRUE;
-			job_id = _jobID;
+		if( err == CLSS_OK && statusJobID[0] != 0x00 ){
+			*isPrinting = CNMPU2_TRUE;
+			strncpy(job_id, statusJobID, CN_IVEC_JOBID_LEN);
 
 #ifdef _DEBUG_MODE_
-			fprintf(stderr, "DEBUG: isPrinting : %d\n", isPrinting);
+			fprintf(stderr, "DEBUG: isPrinting : %d\n", *isPrinting);
 #endif
 		}
 		// else if( strncmp( serviceType, SVC_MAINTENANCE, sizeof(SVC_MAINTENANCE) )  == 0 &&
@@ -1357,15 +1377,158 @@ int CNIF_GetResponse(CNIF_INFO *if_info, char *job_id, int *response_detail, int
 
 
 onErr:
-	free(jobId);
-	free(cmdBuffer);
-	free(tmpBuffer);
-	free(cmdBuffer_big);
-	free(tmpBuffer_big);
-	free(supportID);
-	free(stat_msg);
-	free(stat_tmp_msg);
-
 	return err;
 }
 
+void CNIF_FreeResponseBuffer(void)
+{
+	free(resp_supportID);
+	free(resp_stat_msg);
+	free(resp_stat_tmp_msg);
+	free(resp_cmdBuffer);
+	free(resp_cmdBuffer_big);
+	free(resp_tmpBuffer_big);
+	free(resp_jobId);
+
+	resp_supportID = NULL;
+	resp_stat_msg = NULL;
+	resp_stat_tmp_msg = NULL;
+	resp_cmdBuffer = NULL;
+	resp_cmdBufferSize = 0;
+	resp_cmdBuffer_big = NULL;
+	resp_tmpBuffer_big = NULL;
+	resp_jobId = NULL;
+}
+
+static void StatusMonitorPublish(const STATUS_SNAPSHOT *snapshot)
+{
+	size_t i;
+
+	/* odd while the snapshot is being written */
+	__atomic_store_n(&statmon_seq, statmon_seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	__atomic_store_n(&statmon_snapshot.response, snapshot->response, __ATOMIC_RELAXED);
+	__atomic_store_n(&statmon_snapshot.isCancel, snapshot->isCancel, __ATOMIC_RELAXED);
+	__atomic_store_n(&statmon_snapshot.isError, snapshot->isError, __ATOMIC_RELAXED);
+	__atomic_store_n(&statmon_snapshot.isPrinting, snapshot->isPrinting, __ATOMIC_RELAXED);
+	for (i = 0; i < sizeof(snapshot->jobID); i++) {
+		__atomic_store_n(&statmon_snapshot.jobID[i], snapshot->jobID[i], __ATOMIC_RELAXED);
+	}
+	__atomic_store_n(&statmon_snapshot.count, snapshot->count, __ATOMIC_RELAXED);
+
+	__atomic_store_n(&statmon_seq, statmon_seq + 1, __ATOMIC_RELEASE);
+}
+
+static void StatusMonitorGet(STATUS_SNAPSHOT *snapshot)
+{
+	unsigned int seq;
+	size_t i;
+
+	do {
+		seq = __atomic_load_n(&statmon_seq, __ATOMIC_ACQUIRE);
+
+		snapshot->response = __atomic_load_n(&statmon_snapshot.response, __ATOMIC_RELAXED);
+		snapshot->isCancel = __atomic_load_n(&statmon_snapshot.isCancel, __ATOMIC_RELAXED);
+		snapshot->isError = __atomic_load_n(&statmon_snapshot.isError, __ATOMIC_RELAXED);
+		snapshot->isPrinting = __atomic_load_n(&statmon_snapshot.isPrinting, __ATOMIC_RELAXED);
+		for (i = 0; i < sizeof(snapshot->jobID); i++) {
+			snapshot->jobID[i] = __atomic_load_n(&statmon_snapshot.jobID[i], __ATOMIC_RELAXED);
+		}
+		snapshot->count = __atomic_load_n(&statmon_snapshot.count, __ATOMIC_RELAXED);
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while ((seq & 1) || seq != __atomic_load_n(&statmon_seq, __ATOMIC_RELAXED));
+}
+
+/* take over what the status monitor has seen of the job */
+static void StatusMonitorMerge(const STATUS_SNAPSHOT *snapshot, int *isPrinting, char *job_id)
+{
+	if (snapshot->isPrinting == CNMPU2_TRUE) {
+		*isPrinting = CNMPU2_TRUE;
+		strncpy(job_id, snapshot->jobID, CN_IVEC_JOBID_LEN);
+	}
+}
+
+static void *StatusMonitorThread(void *arg)
+{
+	STATUS_SNAPSHOT snapshot;
+	struct timespec ts;
+	sigset_t mask;
+	int response_detail = 0;
+
+	/* signals are for the main thread */
+	sigfillset(&mask);
+	pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+	memset(&snapshot, 0, sizeof(snapshot));
+
+	pthread_mutex_lock(&statmon_lock);
+	while (!statmon_stop) {
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += CN_STATUS_INTERVAL;
+		while (!statmon_stop) {
+			if (pthread_cond_timedwait(&statmon_cond, &statmon_lock, &ts) == ETIMEDOUT) {
+				break;
+			}
+		}
+		if (statmon_stop) {
+			break;
+		}
+		pthread_mutex_unlock(&statmon_lock);
+
+#ifdef _DEBUG_MODE_
+		fprintf(stderr, "DEBUG: [CNIF_GetResponse] 4sec\n");
+#endif
+		snapshot.response = CNIF_GetResponse(statmon_if_info, snapshot.jobID, &response_detail, statmon_isMaintenance, &snapshot.isPrinting);
+		if (snapshot.response == CN_IVEC_STATUS_CANCELING || snapshot.response == CLSS_OK_AND_CANCEL || snapshot.response == CLSS_NOT_SUPP_AND_CANCEL) {
+			snapshot.isCancel = 1;
+		}
+		snapshot.isError = (snapshot.response < 0);
+		snapshot.count++;
+		StatusMonitorPublish(&snapshot);
+
+		pthread_mutex_lock(&statmon_lock);
+	}
+	pthread_mutex_unlock(&statmon_lock);
+
+	return NULL;
+}
+
+static int StatusMonitorStart(CNIF_INFO *if_info, int isMaintenance)
+{
+	STATUS_SNAPSHOT snapshot;
+
+	memset(&snapshot, 0, sizeof(snapshot));
+	StatusMonitorPublish(&snapshot);
+
+	statmon_if_info = if_info;
+	statmon_isMaintenance = isMaintenance;
+	statmon_stop = 0;
+
+	if (pthread_create(&statmon_thread, NULL, StatusMonitorThread, NULL) != 0) {
+#ifdef _DEBUG_MODE_
+		fprintf(stderr, "DEBUG: status monitor was not started\n");
+#endif
+		return CN_LGMON_ERROR;
+	}
+	statmon_running = 1;
+
+	return CN_LGMON_OK;
+}
+
+static void StatusMonitorStop(void)
+{
+	if (!statmon_running) {
+		return;
+	}
+
+	pthread_mutex_lock(&statmon_lock);
+	statmon_stop = 1;
+	pthread_cond_signal(&statmon_cond);
+	pthread_mutex_unlock(&statmon_lock);
+
+	pthread_join(statmon_thread, NULL);
+	statmon_running = 0;
+}
+
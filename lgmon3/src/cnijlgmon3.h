@@ -38,6 +38,8 @@
 #include <sys/wait.h>
 #include <fcntl.h>
 #include <dlfcn.h>
+#include <pthread.h>
+#include <time.h>
 
 #include <cups/ppd.h>
 #include "cnijcomif.h"
@@ -54,9 +56,19 @@
 #define CN_CMD_INSTALL_NET		("--installer_net")
 #define CN_CNCL_LIB_PATH		("libcnbpcnclapi%s.so")
 
-#define CN_WRITE_SIZE 			(4096)
 #define CN_READ_SIZE 			(4096)
 #define CN_READ_SIZE_BIG		(1024 * 16)
+#define CN_STATUS_INTERVAL		(4)		/* sec */
+
+/*-------Wait Policy (msec)----------*/
+#define CN_WAIT_OPEN_FIRST		(1000)		/* CNIF_Open retry */
+#define CN_WAIT_OPEN_MAX		(30 * 1000)
+#define CN_WAIT_IDLE_FIRST		(100)		/* printer not idle yet */
+#define CN_WAIT_IDLE_MAX		(1000)
+#define CN_WAIT_BUSY_FIRST		(250)		/* session busy */
+#define CN_WAIT_BUSY_MAX		(4 * 1000)
+#define CN_WAIT_DONE_FIRST		(500)		/* job completion */
+#define CN_WAIT_DONE_MAX		(4 * 1000)
 #define CN_LIB_PATH_LEN			(512)
 #define CN_SERIAL_NUM_LEN		(256)
 #define CN_DEVICE_URI_LEN		(256)
@@ -119,7 +131,9 @@
 
 void CNIF_SetSignal(int sign);
 void CNIF_SigCatch(int sign);
-int CNIF_GetResponse(CNIF_INFO *if_info, char *jobId, int *response_detail, int isPrinting);
+extern int interrupt_sign;		/* set by CNIF_SigCatch */
+int CNIF_GetResponse(CNIF_INFO *if_info, char *jobId, int *response_detail, int isMaintenance, int *isPrinting);
+void CNIF_FreeResponseBuffer(void);
 
 #endif
 
@@ -0,0 +1,251 @@
+/*
+ *  Canon Inkjet Printer Driver for Linux
+ *  Copyright CANON INC. 2001-2024
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * NOTE:
+ *  - As a special exception, this program is permissible to link with the
+ *    libraries released as the binary modules.
+ *  - If you write modifications of your own for these programs, it is your
+ *    choice whether to permit this exception to apply to your modifications.
+ *    If you do not wish that, delete this exception.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+#include "cnijnetcache.h"
+
+#define NETCACHE_DIR_NAME	"cnijfilter2"
+#define NETCACHE_FILE_NAME	"netcache"
+#define NETCACHE_MAGIC		"CNNETC01"
+#define NETCACHE_PATH_LEN	(512)
+
+/* cache file: header, then num entries */
+typedef struct {
+	char		magic[8];
+	int32_t		num;
+	int32_t		reserved;
+} NETCACHE_HEADER;
+
+static int GetCachePath( char *path, size_t pathSize )
+{
+	const char *cacheDir = getenv( "CUPS_CACHEDIR" );
+	int len;
+
+	if ( (cacheDir == NULL) || (*cacheDir == '\0') ) return -1;
+
+	len = snprintf( path, pathSize, "%s/%s", cacheDir, NETCACHE_DIR_NAME );
+	if ( (len < 0) || ((size_t)len >= pathSize) ) return -1;
+	if ( (mkdir( path, 0755 ) != 0) && (errno != EEXIST) ) return -1;
+
+	len = snprintf( path, pathSize, "%s/%s/%s", cacheDir, NETCACHE_DIR_NAME, NETCACHE_FILE_NAME );
+	if ( (len < 0) || ((size_t)len >= pathSize) ) return -1;
+
+	return 0;
+}
+
+/* open and lock the cache, shared for reading and exclusive for writing */
+static int OpenCache( int forWrite )
+{
+	char path[NETCACHE_PATH_LEN];
+	struct stat st;
+	int fd;
+
+	if ( GetCachePath( path, sizeof(path) ) != 0 ) return -1;
+
+	if ( forWrite ) {
+		fd = open( path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0644 );
+	}
+	else {
+		fd = open( path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC );
+	}
+	if ( fd < 0 ) return -1;
+
+	/* only files written by this user or root, and by nobody else since */
+	if ( fstat( fd, &st ) != 0 ) goto onErr;
+	if ( !S_ISREG( st.st_mode ) ) goto onErr;
+	if ( (st.st_uid != geteuid()) && (st.st_uid != 0) ) goto onErr;
+	if ( (st.st_mode & (S_IWGRP | S_IWOTH)) != 0 ) goto onErr;
+
+	while ( flock( fd, forWrite ? LOCK_EX : LOCK_SH ) != 0 ) {
+		if ( errno != EINTR ) goto onErr;
+	}
+	return fd;
+
+onErr:
+	close( fd );
+	return -1;
+}
+
+static int ReadAll( int fd, void *buf, size_t size, off_t offset )
+{
+	char *p = buf;
+	ssize_t readSize;
+
+	while ( size > 0 ) {
+		readSize = pread( fd, p, size, offset );
+		if ( readSize < 0 ) {
+			if ( errno == EINTR ) continue;
+			return -1;
+		}
+		if ( readSize == 0 ) return -1;
+		p += readSize;
+		size -= readSize;
+		offset += readSize;
+	}
+	return 0;
+}
+
+static int WriteAll( int fd, const void *buf, size_t size, off_t offset )
+{
+	const char *p = buf;
+	ssize_t written;
+
+	while ( size > 0 ) {
+		written = pwrite( fd, p, size, offset );
+		if ( written < 0 ) {
+			if ( errno == EINTR ) continue;
+			return -1;
+		}
+		p += written;
+		size -= written;
+		offset += written;
+	}
+	return 0;
+}
+
+/* returns the number of entries, an empty or broken file reads as none */
+static int ReadEntries( int fd, CNIJ_NETCACHE_ENTRY *entries )
+{
+	NETCACHE_HEADER header;
+	int i;
+
+	if ( ReadAll( fd, &header, sizeof(NETCACHE_HEADER), 0 ) != 0 ) return 0;
+	if ( memcmp( header.magic, NETCACHE_MAGIC, sizeof(header.magic) ) != 0 ) return 0;
+	if ( (header.num <= 0) || (header.num > NETCACHE_ENTRY_MAX) ) return 0;
+	if ( ReadAll( fd, entries, sizeof(CNIJ_NETCACHE_ENTRY) * header.num, sizeof(NETCACHE_HEADER) ) != 0 ) return 0;
+
+	for ( i = 0; i < header.num; i++ ) {
+		entries[i].macAddr[NETCACHE_MAC_LEN - 1] = '\0';
+		entries[i].ipAddr[NETCACHE_IP_LEN - 1] = '\0';
+		entries[i].modelName[NETCACHE_MODEL_LEN - 1] = '\0';
+	}
+	return header.num;
+}
+
+/* the addresses are checked before use, so a failed write only costs a search */
+static int WriteEntries( int fd, const CNIJ_NETCACHE_ENTRY *entries, int num )
+{
+	NETCACHE_HEADER header;
+	size_t size = sizeof(NETCACHE_HEADER) + sizeof(CNIJ_NETCACHE_ENTRY) * num;
+
+	memset( &header, 0, sizeof(NETCACHE_HEADER) );
+	memcpy( header.magic, NETCACHE_MAGIC, sizeof(header.magic) );
+	header.num = num;
+
+	if ( (WriteAll( fd, &header, sizeof(NETCACHE_HEADER), 0 ) != 0)
+	  || (WriteAll( fd, entries, sizeof(CNIJ_NETCACHE_ENTRY) * num, sizeof(NETCACHE_HEADER) ) != 0)
+	  || (ftruncate( fd, size ) != 0) ) {
+		return -1;
+	}
+	return 0;
+}
+
+static int FindEntry( const CNIJ_NETCACHE_ENTRY *entries, int num, const char *macAddr )
+{
+	int i;
+
+	for ( i = 0; i < num; i++ ) {
+		if ( strcmp( entries[i].macAddr, macAddr ) == 0 ) return i;
+	}
+	return -1;
+}
+
+int NetCacheLookup( const char *macAddr, CNIJ_NETCACHE_ENTRY *entry )
+{
+	CNIJ_NETCACHE_ENTRY entries[NETCACHE_ENTRY_MAX];
+	int num;
+	int i;
+	int fd;
+
+	if ( (macAddr == NULL) || ((fd = OpenCache( 0 )) < 0) ) return -1;
+
+	num = ReadEntries( fd, entries );
+	close( fd );
+
+	if ( (i = FindEntry( entries, num, macAddr )) < 0 ) return -1;
+	if ( entries[i].ipAddr[0] == '\0' ) return -1;
+
+	memcpy( entry, &entries[i], sizeof(CNIJ_NETCACHE_ENTRY) );
+	return 0;
+}
+
+/* add or refresh entries, the least recently stored ones make room */
+void NetCacheStore( const CNIJ_NETCACHE_ENTRY *newEntries, int newNum )
+{
+	CNIJ_NETCACHE_ENTRY entries[NETCACHE_ENTRY_MAX];
+	int64_t now = (int64_t)time( NULL );
+	int num;
+	int i, j;
+	int fd;
+
+	if ( (newEntries == NULL) || (newNum <= 0) || ((fd = OpenCache( 1 )) < 0) ) return;
+
+	num = ReadEntries( fd, entries );
+
+	for ( i = 0; i < newNum; i++ ) {
+		if ( (j = FindEntry( entries, num, newEntries[i].macAddr )) < 0 ) {
+			if ( num < NETCACHE_ENTRY_MAX ) {
+				j = num++;
+			}
+			else {
+				int k;
+				for ( j = 0, k = 1; k < num; k++ ) {
+					if ( entries[k].updated < entries[j].updated ) j = k;
+				}
+			}
+		}
+		memcpy( &entries[j], &newEntries[i], sizeof(CNIJ_NETCACHE_ENTRY) );
+		entries[j].updated = now;
+	}
+
+	WriteEntries( fd, entries, num );
+	close( fd );
+}
+
+void NetCacheRemove( const char *macAddr )
+{
+	CNIJ_NETCACHE_ENTRY entries[NETCACHE_ENTRY_MAX];
+	int num;
+	int i;
+	int fd;
+
+	if ( (macAddr == NULL) || ((fd = OpenCache( 1 )) < 0) ) return;
+
+	num = ReadEntries( fd, entries );
+	if ( (i = FindEntry( entries, num, macAddr )) >= 0 ) {
+		memmove( &entries[i], &entries[i + 1], sizeof(CNIJ_NETCACHE_ENTRY) * (num - i - 1) );
+		WriteEntries( fd, entries, num - 1 );
+	}
+	close( fd );
+}
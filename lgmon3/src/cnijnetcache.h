@@ -0,0 +1,54 @@
+/*
+ *  Canon Inkjet Printer Driver for Linux
+ *  Copyright CANON INC. 2001-2024
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * NOTE:
+ *  - As a special exception, this program is permissible to link with the
+ *    libraries released as the binary modules.
+ *  - If you write modifications of your own for these programs, it is your
+ *    choice whether to permit this exception to apply to your modifications.
+ *    If you do not wish that, delete this exception.
+*/
+
+#ifndef _CNIJNETCACHE_H_
+#define _CNIJNETCACHE_H_
+
+#include <stdint.h>
+
+#define NETCACHE_MAC_LEN		(18)	/* XX-XX-XX-XX-XX-XX */
+#define NETCACHE_IP_LEN			(46)
+#define NETCACHE_MODEL_LEN		(256)
+#define NETCACHE_ENTRY_MAX		(64)
+
+/* one printer found on the network */
+typedef struct {
+	char	macAddr[NETCACHE_MAC_LEN];
+	char	ipAddr[NETCACHE_IP_LEN];
+	char	modelName[NETCACHE_MODEL_LEN];
+	int32_t	protocol;		/* CNCL_GetProtocol of the device ID, 0 when unknown */
+	int64_t	updated;		/* time of the last store */
+} CNIJ_NETCACHE_ENTRY;
+
+/*
+ * MAC to IP address cache shared by discovery and the jobs, kept in
+ * $CUPS_CACHEDIR/cnijfilter2/netcache under an flock. The address may be
+ * stale: the caller must check the printer still answers there.
+ */
+int NetCacheLookup( const char *macAddr, CNIJ_NETCACHE_ENTRY *entry );
+void NetCacheStore( const CNIJ_NETCACHE_ENTRY *entries, int num );
+void NetCacheRemove( const char *macAddr );
+
+#endif
@@ -26,19 +26,16 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include <dlfcn.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
 
 #include "cnijutil.h"
+#include "cnijcapcache.h"
+#include "cnijcncl.h"
 #include "cnijifnet2.h"
 
-#define CN_CNCL_LIB_PATH		("libcnbpcnclapi%s.so")
-#define CN_LIB_PATH_LEN 512
-#define CN_CNCL_LIBNAME "libcnbpcnclapicom2.so"
-
-
-static int (*GetStringWithTagFromFile)(const char*, const char*, int, uint8_t**);
-// static int (*GetStringWithTagFromFile)(const char*, const char*, int*, uint8_t**);
-// static int (*CNCL_GetStringWithTagFromFile)(const char*, const char*, size_t, uint8_t**);
 
 
 
@@ -59,38 +56,146 @@ int GetUUID( char *arg , char *uuid ){
 }
 
 
-int GetCapabilityFromPPDFile(const char *ppdFileName, CAPABILITY_DATA *_data)
+/*
+ * The spool input is read into one page aligned block. The block size is
+ * READ_BLOCK_SIZE unless CNIJ_LGMON_BLOCK_SIZE is set, and it is rounded
+ * up to whole pages.
+ */
+char *AllocReadBlock( size_t *blockSize )
 {
-	char libPathBuf[CN_LIB_PATH_LEN];
-	void *libclss = NULL;
-	char model_number[] = "com2";
+	const char	*env = getenv( READ_BLOCK_ENV );
+	long		page = sysconf( _SC_PAGESIZE );
+	size_t		size = READ_BLOCK_SIZE;
+	void		*block = NULL;
 
-	// snprintf( libPathBuf, CN_LIB_PATH_LEN, "%s%s", optarg, CN_CNCL_LIBNAME );
-	snprintf( libPathBuf, CN_LIB_PATH_LEN - 1, CN_CNCL_LIB_PATH, model_number );
-	// snprintf( libPathBuf, CN_LIB_PATH_LEN, "%s", CN_CNCL_LIBNAME );
+	if ( page <= 0 ) page = 4096;
 
-	libclss = dlopen( libPathBuf, RTLD_LAZY );
-	if ( !libclss ) {
-		fprintf( stderr, "Error in dlopen\n" );
-		goto onErr;
+	if ( env != NULL && atol( env ) > 0 ) {
+		size = (size_t)atol( env );
+		if ( size > READ_BLOCK_SIZE_MAX ) size = READ_BLOCK_SIZE_MAX;
+	}
+	size = (size + page - 1) / page * page;
+
+	if ( posix_memalign( &block, (size_t)page, size ) != 0 ) {
+		return NULL;
 	}
+	*blockSize = size;
+
+	return (char *)block;
+}
 
-	GetStringWithTagFromFile = NULL;
-	GetStringWithTagFromFile = dlsym( libclss, "CNCL_GetStringWithTagFromFile" );
 
-	if ( dlerror() != NULL ) {
-		fprintf( stderr, "Error in CNCL_GetSetConfigurationCommand. API not Found.\n" );
+/*
+ * Read the spool input into buffer. The first read waits for data, then
+ * the reads go on while more data is ready without waiting, so a busy
+ * filter gives whole blocks and a slow one is not held back.
+ * isEOF is set when the end of the input was reached.
+ */
+int ReadBlock( int fd, char *buffer, size_t bufferSize, size_t *readSize, int *isEOF )
+{
+	struct pollfd	pfd;
+	ssize_t			len;
+	size_t			total = 0;
+
+	*isEOF = 0;
+
+	while ( total < bufferSize ) {
+		if ( total > 0 ) {
+			pfd.fd = fd;
+			pfd.events = POLLIN;
+			pfd.revents = 0;
+			if ( poll( &pfd, 1, 0 ) <= 0 ) break;
+		}
+
+		len = read( fd, buffer + total, bufferSize - total );
+		if ( len < 0 ) {
+			if ( errno == EINTR ) {
+				if ( total > 0 ) break;
+				continue;
+			}
+			*readSize = total;
+			return -1;
+		}
+		if ( len == 0 ) {
+			*isEOF = 1;
+			break;
+		}
+		total += len;
+	}
+	*readSize = total;
+
+	return 0;
+}
+
+
+/*
+ * Waits of the status polling. The first wait is short and each following
+ * one is doubled up to max, so a printer that is ready at once is not kept
+ * waiting for a fixed sleep.
+ */
+void InitWaitPolicy( WAIT_POLICY *wait, unsigned int first, unsigned int max )
+{
+	const char	*env = getenv( WAIT_MAX_ENV );
+
+	if ( env != NULL && atoi( env ) > 0 && (unsigned int)atoi( env ) < max ) {
+		max = (unsigned int)atoi( env );
+	}
+	if ( first > max ) first = max;
+
+	wait->first = first;
+	wait->max = max;
+	wait->next = first;
+}
+
+
+void ResetWaitPolicy( WAIT_POLICY *wait )
+{
+	wait->next = wait->first;
+}
+
+
+/*
+ * Sleep for the next interval. A signal ends the wait early when it has set
+ * *interrupt; 1 is returned then.
+ */
+int WaitWithPolicy( WAIT_POLICY *wait, int *interrupt )
+{
+	struct timespec	ts;
+
+	ts.tv_sec = wait->next / 1000;
+	ts.tv_nsec = (long)(wait->next % 1000) * 1000000L;
+
+	while ( nanosleep( &ts, &ts ) != 0 && errno == EINTR ) {
+		if ( interrupt != NULL && *interrupt ) break;
+	}
+
+	wait->next *= 2;
+	if ( wait->next > wait->max ) wait->next = wait->max;
+
+	return ( interrupt != NULL && *interrupt ) ? 1 : 0;
+}
+
+
+int GetCapabilityFromPPDFile(const char *ppdFileName, CAPABILITY_DATA *_data)
+{
+	CNCL_TYPE_GetStringWithTagFromFile GetStringWithTagFromFile;
+
+	/* the process wide CNCL handle, opened on first use */
+	if ( (GetStringWithTagFromFile = CNCL_API( GetStringWithTagFromFile )) == NULL ) {
 		goto onErr;
 	}
 
 	// char *buffer = NULL;
 	uint8_t *buffer = NULL;
+	CNIJ_CAPCACHE_BLOB blob;
 
-	unsigned int bufferSize = 0;
+	int bufferSize = 0;
 
-	bufferSize = GetStringWithTagFromFile(ppdFileName, CNCL_FILE_TAG_DEVICEID, 1, &buffer);
+	bufferSize = CapCacheGetStringWithTag(GetStringWithTagFromFile, ppdFileName, CNCL_FILE_TAG_DEVICEID, 1, &blob);
+	buffer = blob.data;
 
 	if( bufferSize <= 0 ){
+		CapCacheRelease(&blob);
 		return MAKEPPD_FAILED;
 	}
 
@@ -98,6 +203,7 @@ int GetCapabilityFromPPDFile(const char *ppdFileName, CAPABILITY_DATA *_data)
 	temp = (uint8_t *) malloc(1024);
 
 	if( temp == NULL ){
+		CapCacheRelease(&blob);
 		goto onErr;
 	}
 
@@ -111,6 +217,7 @@ int GetCapabilityFromPPDFile(const char *ppdFileName, CAPABILITY_DATA *_data)
 			j++;
 		}
 	}
+	CapCacheRelease(&blob);
 
 	_data->deviceID = temp;
 	_data->deviceIDLength = strlen( (char *)temp );
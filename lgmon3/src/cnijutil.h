@@ -29,6 +29,20 @@
 #define UUID_PTN	"job-uuid=urn:uuid:"
 #define UUID_LEN	(36)
 
+/*-------Spool Input--------------*/
+#define READ_BLOCK_ENV		"CNIJ_LGMON_BLOCK_SIZE"
+#define READ_BLOCK_SIZE		(1024 * 1024)
+#define READ_BLOCK_SIZE_MAX	(64 * 1024 * 1024)
+
+/*-------Wait Policy--------------*/
+#define WAIT_MAX_ENV		"CNIJ_LGMON_WAIT_MAX"	/* msec, lowers the cap of every wait */
+
+typedef struct _WAIT_POLICY{
+  unsigned int first;	/* msec */
+  unsigned int max;		/* msec */
+  unsigned int next;	/* msec */
+} WAIT_POLICY;
+
 #define MAKEPPD_SUCCEEDED	(1)
 #define MAKEPPD_FAILED		(0)
 
@@ -42,3 +56,8 @@ typedef struct _CAPABILITY_DATA{
 
 int GetUUID( char *arg , char *uuid );
 int GetCapabilityFromPPDFile(const char *ppdFileName, CAPABILITY_DATA *_data);
+char *AllocReadBlock( size_t *blockSize );
+int ReadBlock( int fd, char *buffer, size_t bufferSize, size_t *readSize, int *isEOF );
+void InitWaitPolicy( WAIT_POLICY *wait, unsigned int first, unsigned int max );
+void ResetWaitPolicy( WAIT_POLICY *wait );
+int WaitWithPolicy( WAIT_POLICY *wait, int *interrupt );
@@ -34,13 +34,18 @@
 //#include <gtk/gtk.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <unistd.h>
-#include <libxml/parser.h>	/* Ver.2.80 */
+#include <fcntl.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "keytext.h"
 
-#define CNIJLGMON2_RESFILE "cnb_cnijlgmon2.res"
+#define CNIJLGMON2_CATFILE "cnb_cnijlgmon2.cat"
+#define KEYTEXT_CAT_MAGIC "CNKTC02"
+#define KEYTEXT_CAT_HEADER_SIZE (12)
+#define KEYTEXT_CAT_ITEM_SIZE (8)
 
 static const char* g_keytext_dir = NULL;
 static KeyTextList *g_key_keytext_list = NULL;
@@ -71,98 +76,29 @@ static char* CheckFileExists(const char *dirname, const char *filename)
 	return NULL;
 }
 
-static short NewStringList( STRINGLISTCOMP **strListComp, char *key, char *text )
+static uint32_t GetLE32( const unsigned char *p )
 {
-	LPSTRINGLISTCOMP lpStringListComp;
-	short len = 0;
-	short result = -1;
-
-	if ( strListComp == NULL ) goto Err1;
-	if ( strListComp == NULL ) goto Err1;
-	if ( (lpStringListComp = (LPSTRINGLISTCOMP)malloc(sizeof(STRINGLISTCOMP))) == NULL ) goto Err1;
-
-	len = strlen(key) + 1;
-	if ( (lpStringListComp->key = (char *)malloc(len)) == NULL ) goto Err1;
-	strncpy( lpStringListComp->key, key, len );
-	lpStringListComp->key[len-1] = '\0';
-
-	len = strlen(text) + 1;
-	if ( (lpStringListComp->text = (char *)malloc(len)) == NULL ) goto Err2;
-	strncpy( lpStringListComp->text, text, len );
-	lpStringListComp->text[len-1] = '\0';
-
-	lpStringListComp->next = NULL;
-	*strListComp = lpStringListComp;
-
-
-	result = 0;
-	return result;
-
-	if ( lpStringListComp->text != NULL )  free( lpStringListComp->text );
-Err2:
-	if ( lpStringListComp->key != NULL )  free( lpStringListComp->key );
-Err1:
-	return result;
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
 }
 
-static short AppendStringList( STRINGLISTCOMP *root, STRINGLISTCOMP *append )
+/* every offset must point into the string area, which ends with a NUL */
+static short CheckCatalog( const KeyTextList *list )
 {
+	size_t poolTop;
+	uint32_t i;
 	short result = -1;
-	STRINGLISTCOMP *current;
 
-	if ( (root == NULL) || (append == NULL) ) goto Err;
+	if ( list->count > (list->mapSize - KEYTEXT_CAT_HEADER_SIZE) / KEYTEXT_CAT_ITEM_SIZE ) goto Err;
 
-	current = root;
-	while( current->next != NULL ){
-		current = current->next;
-	}
-	current->next = append;
-
-	result = 0;
-Err:
-	return result;
-}
+	poolTop = KEYTEXT_CAT_HEADER_SIZE + (size_t)list->count * KEYTEXT_CAT_ITEM_SIZE;
+	if ( poolTop >= list->mapSize || list->mapTop[list->mapSize - 1] != '\0' ) goto Err;
 
-static short FreeStringListComp( STRINGLISTCOMP *current )
-{
-	short result = -1;
-	if ( current == NULL ) goto Err;
+	for ( i = 0; i < list->count; i++ ){
+		uint32_t keyOff = GetLE32( list->items + i * KEYTEXT_CAT_ITEM_SIZE );
+		uint32_t textOff = GetLE32( list->items + i * KEYTEXT_CAT_ITEM_SIZE + 4 );
 
-	if ( current->key != NULL ) {
-		free( current->key );
-		current->key = NULL;
-	}
-	if ( current->text != NULL ){
-		free( current->text);
-		current->text = NULL;
-	}
-
-	result = 0;
-Err:
-	return result;
-}
-
-static short FreeStringList( STRINGLISTCOMP *list )
-{
-	STRINGLISTCOMP *current, *prev = NULL;
-	short  result = -1;
-
-	if ( list == NULL ) goto Err;
-	current = list;
-
-	while( 1 ) {
-		current = list;
-		if ( current->next == NULL ) {
-			if ( FreeStringListComp( current ) != 0 ) goto Err;
-			break;
-		}
-
-		while( current->next != NULL ) {
-			prev = current;
-			current = current->next;
-		}
-		if ( FreeStringListComp( current ) != 0 ) goto Err;
-		prev->next = NULL;
+		if ( keyOff < poolTop || keyOff >= list->mapSize ) goto Err;
+		if ( textOff < poolTop || textOff >= list->mapSize ) goto Err;
 	}
 
 	result = 0;
@@ -170,95 +106,34 @@ Err:
 	return result;
 }
 
-static short LookupTextFromStringList( STRINGLISTCOMP *list, char *key, char **text )
-{
-	STRINGLISTCOMP *current = NULL;
-	short result = -1;
-
-	if ( list == NULL ) goto Err;
-	current = list;
-
-	while ( current != NULL ){
-		if ( !strcmp( current->key, key ) ){
-			*text = current->text;
-			result = 0;
-			break;
-		}
-		current = current->next;
-	}
-
-	result = 0;
-Err:
-	return result;	
-}
-
-
-
-//static GTree* CreateTree()
-static STRINGLISTCOMP* CreateTree()
-{
-	STRINGLISTCOMP *list = NULL;
-	
-	if ( NewStringList( &list, "", "" ) != 0 ){
-		list = NULL;
-		goto Err;
-	}
-Err:
-	return list;
-}
-
-static void AddKeyAndTextToTree(xmlNodePtr xmlnode, STRINGLISTCOMP* tree)
-{
-	char *key, *text;
-	STRINGLISTCOMP *list = NULL;
-
-	//if( !xmlnode->name || g_strcasecmp((const gchar *)xmlnode->name,"Item") != 0 )
-	if( !xmlnode->name )
-		return;
-
-	key  = (char *)xmlGetProp(xmlnode,(const xmlChar *)"key");
-	text = (char *)xmlNodeGetContent(xmlnode);
-
-	if( key != NULL && text != NULL )
-	{
-		//g_tree_insert(tree, (gpointer)key, (gpointer)text);
-		NewStringList( &list, key, text );
-		AppendStringList( tree, list );
-	}
-}
-
-static void ParseXMLDoc(xmlDocPtr doc, STRINGLISTCOMP* tree)
-{
-	xmlNodePtr node;
-
-/*	for( node = doc->root->childs ; node != NULL ; node = node->next ) */
-	for( node = doc->xmlRootNode->xmlChildrenNode ; node != NULL ; node = node->next )
-	{
-		AddKeyAndTextToTree(node, tree);
-	}
-}
-
-static short ReadXMLFile(char *fname, STRINGLISTCOMP* tree)
+static short MapCatalog( char *fname, KeyTextList *list )
 {
+	struct stat s;
+	void *mapTop = MAP_FAILED;
+	int fd;
 	short result = -1;
-	xmlDocPtr doc;
 
-	if( (doc = xmlParseFile(fname)) == NULL ) goto Err;
+	if ( (fd = open( fname, O_RDONLY )) < 0 ) goto Err1;
+	if ( fstat( fd, &s ) != 0 ) goto Err2;
+	if ( s.st_size <= KEYTEXT_CAT_HEADER_SIZE ) goto Err2;
 
-	if( doc->xmlRootNode == NULL
-	 || doc->xmlRootNode->name == NULL )
-	 //|| g_strcasecmp((const gchar *)doc->xmlRootNode->name, "KeyTextList") != 0)
-	{
-		xmlFreeDoc(doc);
-		goto Err;
-	}
+	if ( (mapTop = mmap( NULL, s.st_size, PROT_READ, MAP_PRIVATE, fd, 0 )) == MAP_FAILED ) goto Err2;
 
-	ParseXMLDoc(doc, tree);
-	xmlFreeDoc(doc);
+	list->mapTop = mapTop;
+	list->mapSize = s.st_size;
+	if ( memcmp( list->mapTop, KEYTEXT_CAT_MAGIC, sizeof(KEYTEXT_CAT_MAGIC) ) != 0 ) goto Err3;
 
+	list->count = GetLE32( list->mapTop + 8 );
+	list->items = list->mapTop + KEYTEXT_CAT_HEADER_SIZE;
+	if ( CheckCatalog( list ) != 0 ) goto Err3;
 
 	result = 0;
-Err:
+	goto Err2;
+Err3:
+	munmap( mapTop, s.st_size );
+Err2:
+	close( fd );
+Err1:
 	return result;
 }
 
@@ -281,25 +156,23 @@ short LoadKeyTextList( void )
 
 	if( !g_keytext_dir  ) goto Err1; 
 
-	if( (pathname = CheckFileExists(g_keytext_dir, CNIJLGMON2_RESFILE)) == NULL ){
-		if( (pathname = CheckFileExists("keytext", CNIJLGMON2_RESFILE)) == NULL )  goto Err1;
+	if( (pathname = CheckFileExists(g_keytext_dir, CNIJLGMON2_CATFILE)) == NULL ){
+		if( (pathname = CheckFileExists("keytext", CNIJLGMON2_CATFILE)) == NULL )  goto Err1;
 	}
 
 	if ( (list = (KeyTextList*)malloc(sizeof(KeyTextList))) == NULL ) goto Err1;
 
-	if( (list->tree = CreateTree()) == NULL ) goto Err2;
-
-	if( ReadXMLFile(pathname, list->tree) != 0 ) goto Err3;
+	if( MapCatalog(pathname, list) != 0 ) goto Err2;
 
 	g_key_keytext_list = list;
+	free( pathname );
 
 	result = 0;
 	return result;
-Err3:
-	FreeStringList( list->tree );
 Err2:
 	free( list );
 Err1:
+	if ( pathname != NULL ) free( pathname );
 	return result;
 }
 
@@ -307,7 +180,7 @@ void FreeKeyTextList( void )
 {
 	if ( g_key_keytext_list == NULL ) return;
 
-	FreeStringList( g_key_keytext_list->tree );
+	munmap( (void *)g_key_keytext_list->mapTop, g_key_keytext_list->mapSize );
 	free( g_key_keytext_list );
 	g_key_keytext_list = NULL;
 	
@@ -322,12 +195,28 @@ void FreeKeyTextDir( void )
 
 char* LookupText(char* key)
 {
-	char *text = NULL;
+	const KeyTextList *list = g_key_keytext_list;
+	uint32_t low, high;
 
-	if( g_key_keytext_list == NULL || g_key_keytext_list->tree == NULL || key == NULL ) return NULL;
+	if( list == NULL || key == NULL ) return NULL;
 
-	if ( LookupTextFromStringList( g_key_keytext_list->tree, key, &text ) != 0 ) return NULL;
+	/* the items are sorted by key */
+	low = 0;
+	high = list->count;
+	while ( low < high ){
+		uint32_t mid = low + (high - low) / 2;
+		const unsigned char *item = list->items + (size_t)mid * KEYTEXT_CAT_ITEM_SIZE;
+		int cmp = strcmp( key, (const char *)list->mapTop + GetLE32( item ) );
 
-	return (char*)dgettext(PACKAGE,text);
+		if ( cmp == 0 ){
+			return (char*)dgettext(PACKAGE,(const char *)list->mapTop + GetLE32( item + 4 ));
+		}
+		if ( cmp < 0 ){
+			high = mid;
+		}
+		else {
+			low = mid + 1;
+		}
+	}
+	return NULL;
 }
-
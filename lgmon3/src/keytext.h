@@ -23,16 +23,16 @@
  */
 
 
-typedef struct stringlistcomp
-{
-	char *key;
-	char *text;
-	struct stringlistcomp *next;
-} STRINGLISTCOMP, *LPSTRINGLISTCOMP;
+#include <stddef.h>
+#include <stdint.h>
 
+/* cnb_cnijlgmon2.cat mapped read only, see keytextc.pl */
 typedef struct
 {
-	STRINGLISTCOMP* tree;
+	const unsigned char *mapTop;
+	size_t mapSize;
+	uint32_t count;
+	const unsigned char *items;
 } KeyTextList;
 
 void SetKeyTextDir(const char* dirname);
@@ -0,0 +1,78 @@
+#!/usr/bin/perl
+#
+# Report the page sizes that tocnpwg has to resample.
+#
+# The rasterizer sizes its page from the *ImageableArea of the size and
+# the HWResolution of the *Resolution choice (cupsRasterInterpretPPD():
+# width = (right - left) * xres / 72 + 0.5). rastertocanonij passes the
+# *%CNSizeToPrintArea pixels to tocnpwg, which resamples every line when
+# the two differ. Borderless sizes (.bl) are enlarged past the paper edge
+# by different factors across and down the page, so they always show up.
+#
+# usage: checkprintarea.pl [-v] [ppd...]    (default: *.ppd)
+# The exit status is 1 when some size still needs resampling.
+#
+
+$verbose = 0;
+if ( @ARGV && $ARGV[0] eq '-v' ) {
+	$verbose = 1;
+	shift @ARGV;
+}
+@ARGV = sort glob( '*.ppd' ) if ( !@ARGV );
+
+$need_num = 0;
+foreach $ppd ( @ARGV ) {
+	my %area = ();
+	my @sizes = ();
+	my %print = ();
+	my @res = ();
+	my $scale = 1.0;
+
+	open( PPD, $ppd ) or die "$ppd: $!\n";
+	while ( <PPD> ) {
+		s/\r?\n$//;
+		if ( /^\*ImageableArea\s+([^\/:]+)[^:]*:\s*"([^"]*)"/ ) {
+			$area{$1} = [ split( ' ', $2 ) ];
+		}
+		elsif ( /^\*%CNSizeToPrintArea\s+(\S+)\s+(\d+)\s+(\d+)/ ) {
+			push @sizes, $1;
+			$print{$1} = [ $2, $3 ];
+		}
+		elsif ( /^\*Resolution\s+([^\/:]+)[^:]*:.*HWResolution\s*\[\s*(\d+)\s+(\d+)\s*\]/ ) {
+			push @res, [ $1, $2, $3 ];
+		}
+		elsif ( /^\*cupsBorderlessScalingFactor:\s*"?([\d.]+)/ ) {
+			$scale = $1;
+		}
+	}
+	close( PPD );
+
+	my $need = 0;
+	foreach $size ( @sizes ) {
+		if ( !exists $area{$size} ) {
+			print "$ppd: $size: no *ImageableArea\n";
+			$need++;
+			next;
+		}
+		my ( $left, $bottom, $right, $top ) = @{$area{$size}};
+		my ( $pw, $ph ) = @{$print{$size}};
+
+		foreach $r ( @res ) {
+			my ( $name, $xres, $yres ) = @$r;
+			my $w = int( ( $right - $left ) * $scale * $xres / 72 + 0.5 );
+			my $h = int( ( $top - $bottom ) * $scale * $yres / 72 + 0.5 );
+
+			if ( $w != $pw || $h != $ph ) {
+				printf "%s: %s %s: raster %dx%d, print area %dx%d\n", $ppd, $size, $name, $w, $h, $pw, $ph;
+				$need++;
+			}
+			elsif ( $verbose ) {
+				printf "%s: %s %s: %dx%d\n", $ppd, $size, $name, $w, $h;
+			}
+		}
+	}
+	$need_num++ if ( $need );
+}
+
+printf "%d of %d PPDs need resampling\n", $need_num, scalar( @ARGV );
+exit( $need_num ? 1 : 0 );
@@ -27,6 +27,7 @@
 
 
 #include "canonopt.h"
+#include "ppdindex.h"
 #include "com_def.h"
 
 
@@ -42,108 +43,44 @@ char *ppd_to_opt_key(PpdToOptKey *p_table, char *ppd_key)
 	return NULL;
 }
 
-static
-int read_line(FILE *fp, char *buf, int buf_size)
-{
-	int cc = EOF;
-	int i = 0;
-
-	if( buf != NULL && buf_size > 0 )
-	{
-		while( (cc = fgetc(fp)) != EOF )
-		{
-			if( cc == 0x0d || cc == 0x0a )
-				break;
-			if( i < buf_size - 1 )
-				buf[i++] = cc;
-		}
-		buf[i] = 0;
-	}
-
-	return (cc == EOF)? -1 : i;
-}
-
-
-#define	LINE_BUF_SIZE	1024
-
-
 PpdToOptKey *alloc_opt_key_table(char *ppd_name, char *ppd_key_name)
 {
-	FILE *fp = fopen(ppd_name, "r");
+	PpdIndex *p_index = ppd_index_get(ppd_name);
+	const PpdIndexRecord *p_record = NULL;
 	PpdToOptKey *p_key_table = NULL;
 	PpdToOptKey *p_table;
-	char line_buf[LINE_BUF_SIZE];
 
-	if( fp != NULL )
+	if( p_index != NULL )
 	{
 		int opt_num = 0;
 
-		while( read_line(fp, line_buf, LINE_BUF_SIZE) >= 0 )
-		{
-			if( line_buf[0] == '*' && line_buf[1] == '%' )
-			{
-				if( !strcmp(strtok(line_buf, " "), ppd_key_name) )
-					opt_num++;
-			}
-		}
+		while( (p_record = ppd_index_next(p_index, ppd_key_name, p_record)) != NULL )
+			opt_num++;
 
 		p_key_table = p_table = (PpdToOptKey*)malloc(sizeof(PpdToOptKey) * (opt_num + 1));
 
 		if( p_key_table != NULL )
 		{
-			rewind(fp);
-
-			while( read_line(fp, line_buf, LINE_BUF_SIZE) >= 0 )
+			/* keys point into the PPD index, which lives as long as the filter */
+			while( (p_record = ppd_index_next(p_index, ppd_key_name, p_record)) != NULL )
 			{
-				if( line_buf[0] == '*' && line_buf[1] == '%' )
+				if( p_record->args[0] != NULL && p_record->args[1] != NULL )
 				{
-					if( !strcmp(strtok(line_buf, " "), ppd_key_name) )
-					{
-						char *ppd_key = strtok(NULL, " ");
-						char *opt_key= strtok(NULL, " ");
-
-						if( ppd_key != NULL && opt_key != NULL )
-						{
-							int ppd_len = strlen(ppd_key) + 1;
-							int opt_len = strlen(opt_key) + 1;
-							int total_size = ppd_len + opt_len;
-
-							p_table->ppd_key = (char*)malloc(total_size);
-
-							if( p_table->ppd_key != NULL )
-							{
-								p_table->opt_key = p_table->ppd_key + ppd_len;
-
- 								strncpy(p_table->ppd_key, ppd_key, ppd_len);
-								strncpy(p_table->opt_key, opt_key, opt_len);
-								p_table->ppd_key[total_size -1] = '\0';
-								p_table++;
-							}
-						}
-					}
+					p_table->ppd_key = (char*)p_record->args[0];
+					p_table->opt_key = (char*)p_record->args[1];
+					p_table++;
 				}
 			}
  			p_table->ppd_key = NULL;
 			p_table->opt_key = NULL;
 		}
-		fclose(fp);
 	}
 	return p_key_table;
 }
 
 void free_opt_key_table(PpdToOptKey *p_opt_key_table)
 {
-	if( p_opt_key_table != NULL )
-	{
-		PpdToOptKey *p_table = p_opt_key_table;
-
-		while( p_table->ppd_key != NULL )
-		{
-			free(p_table->ppd_key);
-			p_table++;
-		}
-		free(p_opt_key_table);
-	}
+	free(p_opt_key_table);
 }
 
 
@@ -172,68 +109,45 @@ onErr:
 
 SizeToPrintArea *alloc_size_to_print_area_table(char *ppd_name)
 {
-	FILE *fp = fopen(ppd_name, "r");
+	PpdIndex *p_index = ppd_index_get(ppd_name);
+	const PpdIndexRecord *p_record = NULL;
 	SizeToPrintArea *p_table_top = NULL;
 	SizeToPrintArea *p_table;
 	long mem_size = 0;
-	char line_buf[LINE_BUF_SIZE];
 
-	if( fp != NULL )
+	if( p_index != NULL )
 	{
 		int opt_num = 0;
 
-		while( read_line(fp, line_buf, LINE_BUF_SIZE) >= 0 )
-		{
-			if( line_buf[0] == '*' && line_buf[1] == '%' )
-			{
-				if( !strcmp(strtok(line_buf, " "), "*%CNSizeToPrintArea") )
-					opt_num++;
-			}
-		}
+		while( (p_record = ppd_index_next(p_index, "*%CNSizeToPrintArea", p_record)) != NULL )
+			opt_num++;
 		DEBUG_PRINT2( "DEBUG:[rastertocanonij] opt_num : opt_num:%d\n",opt_num );
 
 		mem_size = sizeof(SizeToPrintArea) * (opt_num + 1);
 		p_table_top = p_table = (SizeToPrintArea*)malloc( mem_size );
-		memset( p_table, 0x00, mem_size );
 
 		if( p_table_top != NULL )
 		{
-			rewind(fp);
+			memset( p_table, 0x00, mem_size );
 
-			while( read_line(fp, line_buf, LINE_BUF_SIZE) >= 0 )
+			while( (p_record = ppd_index_next(p_index, "*%CNSizeToPrintArea", p_record)) != NULL )
 			{
-				if( line_buf[0] == '*' && line_buf[1] == '%' )
+				char *size_key = (char*)p_record->args[0];
+				long w = (p_record->args[1] != NULL)? atol( p_record->args[1] ) : 0;
+				long h = (p_record->args[2] != NULL)? atol( p_record->args[2] ) : 0;
+
+				if( (size_key != NULL) && (w != 0) && (h != 0) )
 				{
-					if( !strcmp(strtok(line_buf, " "), "*%CNSizeToPrintArea") )
-					{
-						char *size_key = strtok(NULL, " ");
-						long w = atol( strtok(NULL, " ") );
-						long h = atol( strtok(NULL, " ") );
-
-						if( (size_key != NULL) && (w != 0) && (h != 0) )
-						{
-							int size_len = strlen(size_key) + 1;
-
-							p_table->size_key = (char*)malloc(size_len);
-
-							if( p_table->size_key != NULL )
-							{
- 								//strcpy(p_table->size_key, size_key);
- 								strncpy(p_table->size_key, size_key, size_len);
- 								p_table->size_key[size_len -1] = '\0';
-								p_table->width = w;
-								p_table->height = h;
-								p_table++;
-							}
-						}
-					}
+					p_table->size_key = size_key;
+					p_table->width = w;
+					p_table->height = h;
+					p_table++;
 				}
 			}
  			p_table->size_key = NULL;
 			p_table->width = 0;
 			p_table->height = 0;
 		}
-		fclose(fp);
 	}
 	return p_table_top;
 }
@@ -241,15 +155,5 @@ SizeToPrintArea *alloc_size_to_print_area_table(char *ppd_name)
 
 void free_size_to_print_area_table(SizeToPrintArea *p_table_top)
 {
-	if( p_table_top != NULL )
-	{
-		SizeToPrintArea *p_table = p_table_top;
-		while( p_table->size_key != NULL ){
-			free( p_table->size_key );
-			p_table++;
-		}
-		free( p_table_top );
-	}
+	free( p_table_top );
 }
-
-
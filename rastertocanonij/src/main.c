@@ -133,6 +133,8 @@ static int GetOptionBufSize( ParamList *p_list )
 	int result = -1;
 	int key_len, val_len;
 	int total_len = 0;
+	ParamEntry *p_entry;
+	int i;
 
 	if ( p_list == NULL ) goto onErr;
 
@@ -144,15 +146,14 @@ static int GetOptionBufSize( ParamList *p_list )
 
 	/* tocnij */
 	total_len += strlen( TOCNIJ_PATH ) + 1 + strlen( TOCNIJ_BIN ) + 1;
-	while( p_list != NULL ) {
-		key_len = strlen( p_list->key );
-		val_len = strlen( p_list->value );
+	for ( i = 0; (p_entry = param_list_entry( p_list, i )) != NULL; i++ ) {
+		key_len = strlen( p_entry->key );
+		val_len = strlen( p_entry->value );
 	
-		DEBUG_PRINT2( "DEBUG:[rastertocanonij] key : %s\n", p_list->key );
-		DEBUG_PRINT2( "DEBUG:[rastertocanonij] val : %s\n", p_list->value );
+		DEBUG_PRINT2( "DEBUG:[rastertocanonij] key : %s\n", p_entry->key );
+		DEBUG_PRINT2( "DEBUG:[rastertocanonij] val : %s\n", p_entry->value );
 
 		total_len += (key_len + 1 + val_len + 1);
-		p_list = p_list->next;
 	}
 	/* teminate */
 	total_len += 1;
@@ -169,10 +170,10 @@ onErr:
 static int MakeExecCommand( char *cmd_buf, int cmd_buf_size, ParamList *p_list, ParamList *p_list2 )
 {
 	int result = -1;
-	int i;
+	int i, j;
 	char tmp_buf[CMD_BUF_SIZE];
 	ParamList *list_array[2];
-	ParamList *p_cur;
+	ParamEntry *p_cur;
 
 	/* Set tocnpwg path */
 	snprintf( tmp_buf, CMD_BUF_SIZE, "%s%s", GetExecProgPath(), TOPWG_BIN );
@@ -192,14 +193,13 @@ static int MakeExecCommand( char *cmd_buf, int cmd_buf_size, ParamList *p_list,
 	list_array[0] = p_list;
 	list_array[1] = p_list2;
 	for ( i=0; i<2; i++ ){	
-		p_cur = list_array[i];
-		while ( p_cur != NULL ) {
+		/* newest option first */
+		for ( j = param_list_num( list_array[i] ) - 1; j >= 0; j-- ) {
+			p_cur = param_list_entry( list_array[i], j );
 			strcat( cmd_buf, " " );
 			strcat( cmd_buf, p_cur->key );
 			strcat( cmd_buf, " " );
 			strcat( cmd_buf, p_cur->value );
-
-			p_cur = p_cur->next;
 		}
 	}
 
@@ -217,14 +217,12 @@ static int MakeExecCommand( char *cmd_buf, int cmd_buf_size, ParamList *p_list,
 	strcat( cmd_buf, tmp_buf );
 
 	/* Set tocnij option */
-	p_cur = list_array[0];
-	while ( p_cur != NULL ) {
+	for ( j = param_list_num( list_array[0] ) - 1; j >= 0; j-- ) {
+		p_cur = param_list_entry( list_array[0], j );
 		strcat( cmd_buf, " " );
 		strcat( cmd_buf, p_cur->key );
 		strcat( cmd_buf, " " );
 		strcat( cmd_buf, p_cur->value );
-
-		p_cur = p_cur->next;
 	}
 
 	DEBUG_PRINT2( "DEBUG:[rastertocanonij] cmd_buf%s",cmd_buf );
@@ -30,83 +30,205 @@
 		__asm__(".symver memcpy, memcpy@GLIBC_2.2.5");
 #endif
 
-ParamList *param_list_find(ParamList *pl, const char *key)
+#define	PARAM_ARENA_BLOCK_SIZE	2048
+#define	PARAM_LIST_INIT_CAP		32
+
+/* keys and values are carved from a few blocks and freed together */
+struct param_arena_s {
+	ParamArena *next;
+	size_t size;
+	size_t used;
+	char data[1];
+};
+
+static void *arena_alloc(ParamArena **p_arena, size_t size)
 {
-	ParamList *curs;
+	ParamArena *arena = *p_arena;
+	void *p;
 
-	for( curs = pl ; curs != NULL ; curs = curs->next )
+	size = (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+
+	if( arena == NULL || arena->size - arena->used < size )
 	{
-		if( !strcmp(curs->key, key) )
-			return curs;
+		size_t block_size = (size > PARAM_ARENA_BLOCK_SIZE)? size : PARAM_ARENA_BLOCK_SIZE;
+
+		if( (arena = (ParamArena*)malloc(sizeof(ParamArena) + block_size)) == NULL )
+			return NULL;
+
+		arena->next = *p_arena;
+		arena->size = block_size;
+		arena->used = 0;
+		*p_arena = arena;
 	}
-	return NULL;
+
+	p = arena->data + arena->used;
+	arena->used += size;
+	return p;
 }
 
-void param_list_delete(ParamList **root, const char *key)
+static unsigned int hash_key(const char *key)
 {
-	ParamList *curs;
-	ParamList *prev = NULL;
+	unsigned int h = 2166136261U;
 
-	for( curs = *root ; curs != NULL ; prev = curs, curs = curs->next )
+	while( *key )
 	{
-		if( !strcmp(curs->key, key) )
-		{
-			if( prev != NULL )
-				prev->next = curs->next;
-			else
-				*root = curs->next;
-
-			free(curs->key);
-			free(curs->value);
-			free(curs);
+		h ^= (unsigned char)*key++;
+		h *= 16777619U;
+	}
+	return h;
+}
+
+/* slot holding key, or the empty slot where it would go */
+static int *find_slot(ParamList *pl, const char *key)
+{
+	unsigned int i = hash_key(key) & pl->slot_mask;
+
+	while( pl->slots[i] != 0 )
+	{
+		if( !strcmp(pl->entries[pl->slots[i] - 1].key, key) )
 			break;
-		}
+		i = (i + 1) & pl->slot_mask;
+	}
+	return &pl->slots[i];
+}
+
+/* later entries win, so a duplicated key finds its newest value */
+static int rebuild_slots(ParamList *pl, int slot_num)
+{
+	int *slots = (int*)calloc(slot_num, sizeof(int));
+	int i;
+
+	if( slots == NULL )
+		return -1;
+
+	free(pl->slots);
+	pl->slots = slots;
+	pl->slot_mask = slot_num - 1;
+
+	for( i = 0 ; i < pl->num ; i++ )
+		*find_slot(pl, pl->entries[i].key) = i + 1;
+
+	return 0;
+}
+
+static ParamList *param_list_new(void)
+{
+	ParamList *pl = (ParamList*)calloc(1, sizeof(ParamList));
+
+	if( pl == NULL )
+		return NULL;
+
+	pl->entries = (ParamEntry*)malloc(sizeof(ParamEntry) * PARAM_LIST_INIT_CAP);
+	pl->cap = PARAM_LIST_INIT_CAP;
+
+	if( pl->entries == NULL || rebuild_slots(pl, PARAM_LIST_INIT_CAP * 2) != 0 )
+	{
+		free(pl->entries);
+		free(pl);
+		return NULL;
+	}
+	return pl;
+}
+
+ParamEntry *param_list_find(ParamList *pl, const char *key)
+{
+	int index;
+
+	if( pl == NULL )
+		return NULL;
+
+	index = *find_slot(pl, key);
+	return (index != 0)? &pl->entries[index - 1] : NULL;
+}
+
+void param_list_delete(ParamList **root, const char *key)
+{
+	ParamList *pl = *root;
+	ParamEntry *entry = param_list_find(pl, key);
+
+	if( entry != NULL )
+	{
+		int index = entry - pl->entries;
+
+		/* the arena keeps the strings until param_list_free */
+		memmove(entry, entry + 1, sizeof(ParamEntry) * (pl->num - index - 1));
+		pl->num--;
+		rebuild_slots(pl, pl->slot_mask + 1);
 	}
 }
 
 void param_list_add_multi(ParamList **root,
 		const char *key, const char *value, int value_size, int multi_key)
 {
+	ParamList *pl;
+	ParamEntry *entry;
+	int key_len;
 
-	if(multi_key || param_list_find(*root, key) == NULL){
-		ParamList *pl = (ParamList*)malloc(sizeof(ParamList));
-		int key_len = strlen(key);
+	if( *root == NULL && (*root = param_list_new()) == NULL )
+		return;
+	pl = *root;
 
-		param_list_delete(root, key);
+	if( !multi_key && param_list_find(pl, key) != NULL )
+		return;
 
-		pl->next = *root;
-		pl->key = malloc(key_len + 1);
-		memcpy(pl->key, key, key_len + 1);
+	param_list_delete(root, key);
 
-		pl->value = malloc(value_size);
-		memcpy(pl->value, value, value_size);
-		pl->value_size = value_size;
-		*root = pl;
+	if( pl->num == pl->cap )
+	{
+		ParamEntry *entries;
+
+		/* keep the slots at least twice the capacity */
+		if( rebuild_slots(pl, pl->cap * 4) != 0 )
+			return;
+
+		if( (entries = (ParamEntry*)realloc(pl->entries, sizeof(ParamEntry) * pl->cap * 2)) == NULL )
+			return;
+		pl->entries = entries;
+		pl->cap *= 2;
 	}
 
+	key_len = strlen(key);
+	entry = &pl->entries[pl->num];
+	entry->key = arena_alloc(&pl->arena, key_len + 1);
+	entry->value = arena_alloc(&pl->arena, value_size);
+	if( entry->key == NULL || entry->value == NULL )
+		return;
+
+	memcpy(entry->key, key, key_len + 1);
+	memcpy(entry->value, value, value_size);
+	entry->value_size = value_size;
+
+	*find_slot(pl, key) = ++pl->num;
 }
 
 void param_list_free(ParamList *pl)
 {
-	ParamList *next;
+	ParamArena *next;
 
-	for( ; pl != NULL ; pl = next )
-	{
-		next = pl->next;
+	if( pl == NULL )
+		return;
 
-		free(pl->key);
-		free(pl->value);
-		free(pl);
+	for( ; pl->arena != NULL ; pl->arena = next )
+	{
+		next = pl->arena->next;
+		free(pl->arena);
 	}
+	free(pl->slots);
+	free(pl->entries);
+	free(pl);
 }
 
 int param_list_num(ParamList *pl)
 {
-	int num = 0;
+	return (pl != NULL)? pl->num : 0;
+}
 
-	for( ; pl != NULL ; pl = pl->next )
-		num++;
-	return num;
+/* index 0 is the oldest option */
+ParamEntry *param_list_entry(ParamList *pl, int index)
+{
+	if( pl == NULL || index < 0 || index >= pl->num )
+		return NULL;
+	return &pl->entries[index];
 }
 
 void param_list_print(ParamList *pl)
@@ -115,13 +237,15 @@ void param_list_print(ParamList *pl)
 
 	if( fp )
 	{
+		int i;
+
 		fprintf(fp, "---- param_list_print ----\n");
-		for( ; pl != NULL ; pl = pl->next )
+		for( i = param_list_num(pl) - 1 ; i >= 0 ; i-- )
 		{
 			char value_buf[MAX_VALUE_LEN + 1];
-			memcpy(value_buf, pl->value, pl->value_size);
-			value_buf[pl->value_size] = 0;
-			fprintf(fp, "key=%s, value=%s\n", pl->key, value_buf);
+			memcpy(value_buf, pl->entries[i].value, pl->entries[i].value_size);
+			value_buf[pl->entries[i].value_size] = 0;
+			fprintf(fp, "key=%s, value=%s\n", pl->entries[i].key, value_buf);
 		}
 		fclose(fp);
 	}
@@ -129,16 +253,9 @@ void param_list_print(ParamList *pl)
 
 char *ref_value_from_list( ParamList *root, const char *key )
 {
-	ParamList *curs;
-	char *result = NULL;
+	ParamEntry *entry = param_list_find( root, key );
 
-	for( curs = root ; curs != NULL ; curs = curs->next ) {
-		DEBUG_PRINT2( "DEBUG:[rastertocanonij(paramlist.c)] key : %s\n", curs->key );
-		if( !strcmp(curs->key, key) ) {
-			result = curs->value;
-			break;
-		}
-	}
+	DEBUG_PRINT3( "DEBUG:[rastertocanonij(paramlist.c)] key : %s (%s)\n", key, (entry != NULL)? "found" : "not found" );
 
-	return result;
+	return (entry != NULL)? entry->value : NULL;
 }
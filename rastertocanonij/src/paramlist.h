@@ -25,20 +25,32 @@
 
 
 typedef struct param_list_s ParamList;
+typedef struct param_entry_s ParamEntry;
+typedef struct param_arena_s ParamArena;
 
-struct param_list_s {
-  ParamList *next;
+struct param_entry_s {
   char *key;
   char *value;
   int value_size;
 };
 
-ParamList *param_list_find(ParamList *pl, const char *key);
+/* options in insertion order; keys and values live in the arena */
+struct param_list_s {
+  ParamEntry *entries;
+  int num;
+  int cap;
+  int *slots;		/* open addressing, entry index + 1, 0 is empty */
+  int slot_mask;
+  ParamArena *arena;
+};
+
+ParamEntry *param_list_find(ParamList *pl, const char *key);
 void param_list_delete(ParamList **root, const char *key);
 void param_list_add_multi(ParamList **root,
 		const char *key, const char *value, int value_size, int multi);
 void param_list_free(ParamList *pl);
 int param_list_num(ParamList *pl);
+ParamEntry *param_list_entry(ParamList *pl, int index);
 void param_list_print(ParamList *pl);
 char *ref_value_from_list( ParamList *root, const char *key );
 
@@ -0,0 +1,223 @@
+/*
+ *  CUPS add-on module for Canon Inkjet Printer.
+ *  Copyright CANON INC. 2001-2024
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "ppdindex.h"
+#include "com_def.h"
+
+
+#define	PPD_INDEX_PREFIX	"*%CN"
+
+typedef struct line_span_s
+{
+	const char *top;
+	long len;
+} LineSpan;
+
+
+/* one index per PPD name, the option tables point into their pools */
+typedef struct ppd_index_entry_s
+{
+	char *name;
+	PpdIndex *index;
+	struct ppd_index_entry_s *next;
+} PpdIndexEntry;
+
+static PpdIndexEntry *g_index_list = NULL;
+
+
+/* collect every *%CN line of the mapped PPD in one pass */
+static int scan_cn_lines(const char *top, long size, LineSpan **pp_spans, int *p_num, long *p_pool_size)
+{
+	const char *p = top;
+	const char *end = top + size;
+	LineSpan *p_spans = NULL;
+	int num = 0;
+	int cap = 0;
+	long pool_size = 0;
+
+	while( p < end )
+	{
+		const char *line = p;
+
+		while( p < end && *p != 0x0d && *p != 0x0a )
+			p++;
+
+		if( (p - line) > (long)(sizeof(PPD_INDEX_PREFIX) - 1)
+			&& !memcmp(line, PPD_INDEX_PREFIX, sizeof(PPD_INDEX_PREFIX) - 1) )
+		{
+			if( num == cap )
+			{
+				LineSpan *p_new;
+
+				cap = (cap == 0)? 64 : cap * 2;
+				p_new = (LineSpan*)realloc(p_spans, sizeof(LineSpan) * cap);
+				if( p_new == NULL )
+				{
+					free(p_spans);
+					return -1;
+				}
+				p_spans = p_new;
+			}
+			p_spans[num].top = line;
+			p_spans[num].len = p - line;
+			pool_size += p - line + 1;
+			num++;
+		}
+		p++;
+	}
+
+	*pp_spans = p_spans;
+	*p_num = num;
+	*p_pool_size = pool_size;
+	return 0;
+}
+
+static void split_record(char *line, PpdIndexRecord *p_record)
+{
+	char *save = NULL;
+	int i;
+
+	p_record->tag = strtok_r(line, " ", &save);
+	for( i = 0; i < PPD_INDEX_MAX_ARGS; i++ )
+		p_record->args[i] = (p_record->tag != NULL)? strtok_r(NULL, " ", &save) : NULL;
+}
+
+static PpdIndex *build_index(const char *ppd_name)
+{
+	PpdIndex *p_index = NULL;
+	LineSpan *p_spans = NULL;
+	struct stat st;
+	void *map_top = MAP_FAILED;
+	int fd;
+	int num = 0;
+	long pool_size = 0;
+	char *p_pool;
+	int i;
+
+	if( (fd = open(ppd_name, O_RDONLY)) < 0 )
+		return NULL;
+
+	if( fstat(fd, &st) != 0 )
+		goto onErr;
+
+	if( st.st_size > 0 )
+	{
+		map_top = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if( map_top == MAP_FAILED )
+			goto onErr;
+
+		if( scan_cn_lines((const char*)map_top, st.st_size, &p_spans, &num, &pool_size) != 0 )
+			goto onErr;
+	}
+
+	p_index = (PpdIndex*)calloc(1, sizeof(PpdIndex));
+	if( p_index == NULL )
+		goto onErr;
+
+	p_index->records = (PpdIndexRecord*)calloc(num + 1, sizeof(PpdIndexRecord));
+	p_index->pool = (char*)malloc(pool_size + 1);
+	if( p_index->records == NULL || p_index->pool == NULL )
+	{
+		free(p_index->records);
+		free(p_index->pool);
+		free(p_index);
+		p_index = NULL;
+		goto onErr;
+	}
+
+	p_pool = p_index->pool;
+	for( i = 0; i < num; i++ )
+	{
+		memcpy(p_pool, p_spans[i].top, p_spans[i].len);
+		p_pool[p_spans[i].len] = '\0';
+		split_record(p_pool, &p_index->records[p_index->record_num]);
+		if( p_index->records[p_index->record_num].tag != NULL )
+			p_index->record_num++;
+		p_pool += p_spans[i].len + 1;
+	}
+	DEBUG_PRINT2( "DEBUG:[rastertocanonij] ppd index : %d records\n", p_index->record_num );
+
+onErr:
+	free(p_spans);
+	if( map_top != MAP_FAILED )
+		munmap(map_top, st.st_size);
+	close(fd);
+	return p_index;
+}
+
+
+/*
+ * built on first use of each PPD name and kept for the life of the filter,
+ * the caller must not free it
+ */
+PpdIndex *ppd_index_get(const char *ppd_name)
+{
+	PpdIndexEntry *p_entry;
+
+	if( ppd_name == NULL )
+		return NULL;
+
+	for( p_entry = g_index_list; p_entry != NULL; p_entry = p_entry->next )
+	{
+		if( !strcmp(p_entry->name, ppd_name) )
+			return p_entry->index;
+	}
+
+	if( (p_entry = (PpdIndexEntry*)calloc(1, sizeof(PpdIndexEntry))) == NULL )
+		return NULL;
+
+	if( (p_entry->name = strdup(ppd_name)) == NULL
+		|| (p_entry->index = build_index(ppd_name)) == NULL )
+	{
+		free(p_entry->name);
+		free(p_entry);
+		return NULL;
+	}
+
+	p_entry->next = g_index_list;
+	g_index_list = p_entry;
+	return p_entry->index;
+}
+
+const PpdIndexRecord *ppd_index_next(const PpdIndex *p_index, const char *tag, const PpdIndexRecord *p_prev)
+{
+	const PpdIndexRecord *p_record;
+	const PpdIndexRecord *p_end;
+
+	if( p_index == NULL || tag == NULL )
+		return NULL;
+
+	p_record = (p_prev == NULL)? p_index->records : p_prev + 1;
+	p_end = p_index->records + p_index->record_num;
+
+	for( ; p_record < p_end; p_record++ )
+	{
+		if( !strcmp(p_record->tag, tag) )
+			return p_record;
+	}
+	return NULL;
+}
@@ -0,0 +1,43 @@
+/*
+ *  CUPS add-on module for Canon Inkjet Printer.
+ *  Copyright CANON INC. 2001-2024
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef _ppdindex_
+#define _ppdindex_
+
+#define	PPD_INDEX_MAX_ARGS	3
+
+/* one "*%CN..." line of the PPD, split on spaces like strtok(line, " ") */
+typedef struct ppd_index_record_s
+{
+	const char *tag;
+	const char *args[PPD_INDEX_MAX_ARGS];	/* NULL when absent */
+} PpdIndexRecord;
+
+typedef struct ppd_index_s
+{
+	char *pool;
+	PpdIndexRecord *records;
+	int record_num;
+} PpdIndex;
+
+
+/* shared per PPD name and kept until exit, do not free */
+PpdIndex *ppd_index_get(const char *ppd_name);
+const PpdIndexRecord *ppd_index_next(const PpdIndex *p_index, const char *tag, const PpdIndexRecord *p_prev);
+
+#endif
@@ -0,0 +1,412 @@
+/*
+ *  Canon Inkjet Printer Driver for Linux
+ *  Copyright CANON INC. 2001-2024
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * NOTE:
+ *  - As a special exception, this program is permissible to link with the
+ *    libraries released as the binary modules.
+ *  - If you write modifications of your own for these programs, it is your
+ *    choice whether to permit this exception to apply to your modifications.
+ *    If you do not wish that, delete this exception.
+*/
+
+/* Generated by paramhash.sh from cncl_paramtbl.h. Do not edit. */
+
+#ifndef __CNCL_PARAMHASH_H__
+#define __CNCL_PARAMHASH_H__
+
+#include <string.h>
+
+typedef struct {
+	const char *optName;	/* normalized name, NULL for an empty slot */
+	long optNum;
+}ParamHashSlot;
+
+typedef struct {
+	unsigned long seed;
+	unsigned long mask;
+	const ParamHashSlot *slots;
+}ParamHashTbl;
+
+static inline unsigned long ParamHash( unsigned long seed, const char *str )
+{
+	unsigned long h = 2166136261UL ^ seed;
+
+	while( *str ){
+		h ^= (unsigned char)*str++;
+		h = (h * 16777619UL) & 0xffffffffUL;
+	}
+	return h;
+}
+
+/* name must already be normalized (see to_lower_except_size_X) */
+static inline long ParamHashLookup( const ParamHashTbl *tbl, const char *name )
+{
+	const ParamHashSlot *slot = &tbl->slots[ParamHash( tbl->seed, name ) & tbl->mask];
+
+	if ( slot->optName == NULL || strcmp( slot->optName, name ) ) return -1;
+	return slot->optNum;
+}
+
+static const ParamHashSlot mediatypeHashSlots[] = {
+	{ NULL, -1 },
+	{ "highres", CNCL_PSET_MEDIA_HIGHRES },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "greetingcard", CNCL_PSET_MEDIA_GREETING_CARD },
+	{ NULL, -1 },
+	{ "photopaperpro", CNCL_PSET_MEDIA_PROPHOTO },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "matte", CNCL_PSET_MEDIA_MATTE_PAPER },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "procrystalgrade", CNCL_PSET_MEDIA_PHOTO_PAPER_PRO_CRYSTAL_GRADE },
+	{ NULL, -1 },
+	{ "photopaper", CNCL_PSET_MEDIA_PHOTOPAPER },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "ijpostcard", CNCL_PSET_MEDIA_INKJET_HAGAKI },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "envelope", CNCL_PSET_MEDIA_ENVELOPE },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "semigloss", CNCL_PSET_MEDIA_PHOTO_PAPER_SG },
+	{ "photopaperpro2", CNCL_PSET_MEDIA_PHOTO_PAPER_PRO_II },
+	{ "medicine", CNCL_PSET_MEDIA_MEDICINE_ENVELOPE },
+	{ "luster", CNCL_PSET_MEDIA_PHOTO_PAPER_PRO_LUSTER },
+	{ NULL, -1 },
+	{ "proplatinum", CNCL_PSET_MEDIA_PHOTO_PAPER_PRO_PLATINUM },
+	{ "postcard", CNCL_PSET_MEDIA_HAGAKI },
+	{ "glossypaper", CNCL_PSET_MEDIA_GLOSSY_PAPER },
+	{ "photo", CNCL_PSET_MEDIA_OTHER_PHOTO_PAPER },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "plain", CNCL_PSET_MEDIA_PLAIN },
+	{ "superphoto", CNCL_PSET_MEDIA_SUPER_PHOTO_PAPER },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "thin", CNCL_PSET_MEDIA_THIN_PAPER },
+	{ "cardstock", CNCL_PSET_MEDIA_CARDSTOCK },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "glossygold", CNCL_PSET_MEDIA_PHOTO_PAPER_PLUS_GLOSSY_II },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "deliveryslip", CNCL_PSET_MEDIA_DELIVERY_SLIP },
+	{ NULL, -1 },
+	{ "label", CNCL_PSET_MEDIA_LABEL },
+	{ "glossylabel", CNCL_PSET_MEDIA_GLOSSY_LABEL },
+	{ NULL, -1 },
+};
+static const ParamHashTbl mediatypeHash = { 0UL, 63UL, mediatypeHashSlots };
+
+static const ParamHashSlot papersizeHashSlots[] = {
+	{ NULL, -1 },
+	{ "boficio", CNCL_PSET_SIZE_B_OFICIO },
+	{ "businesscard", CNCL_PSET_SIZE_BUSINESSCARD },
+	{ "oficio", CNCL_PSET_SIZE_OFICIO },
+	{ "7x10.bl", CNCL_PSET_SIZE_7X10 },
+	{ NULL, -1 },
+	{ "l", CNCL_PSET_SIZE_L },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "a3plus", CNCL_PSET_SIZE_A3_PLUS },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "a6", CNCL_PSET_SIZE_A6 },
+	{ "a3.bl", CNCL_PSET_SIZE_A3 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "businesscard.bl", CNCL_PSET_SIZE_BUSINESSCARD },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "foolscap", CNCL_PSET_SIZE_FOOLSCAP },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "5x7in.bl", CNCL_PSET_SIZE_5X7 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "l.bl", CNCL_PSET_SIZE_L },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "10x12.bl", CNCL_PSET_SIZE_4GIRI },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "postcard.bl", CNCL_PSET_SIZE_POST },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "a4.bl", CNCL_PSET_SIZE_A4 },
+	{ "letter", CNCL_PSET_SIZE_LETTER },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "square4in", CNCL_PSET_SIZE_SQUARE_4IN },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "5x7in", CNCL_PSET_SIZE_5X7 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "envelop10p", CNCL_PSET_SIZE_ENV_10 },
+	{ NULL, -1 },
+	{ "square4in.bl", CNCL_PSET_SIZE_SQUARE_4IN },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "legalindia", CNCL_PSET_SIZE_LEGAL_INDIA },
+	{ NULL, -1 },
+	{ "a5", CNCL_PSET_SIZE_A5 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "square127.bl", CNCL_PSET_SIZE_SQUARE_127 },
+	{ "postcard", CNCL_PSET_SIZE_POST },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "b5", CNCL_PSET_SIZE_B5 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "executive", CNCL_PSET_SIZE_EXECUTIVE },
+	{ NULL, -1 },
+	{ "square89.bl", CNCL_PSET_SIZE_SQUARE_89 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "square127", CNCL_PSET_SIZE_SQUARE_127 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "7x10", CNCL_PSET_SIZE_7X10 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "a3plus.bl", CNCL_PSET_SIZE_A3_PLUS },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "moficio", CNCL_PSET_SIZE_M_OFICIO },
+	{ "b5.bl", CNCL_PSET_SIZE_B5 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "4x6", CNCL_PSET_SIZE_4X6 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "square89", CNCL_PSET_SIZE_SQUARE_89 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "legal", CNCL_PSET_SIZE_LEGAL },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "b6h", CNCL_PSET_SIZE_B6H },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "8x10.bl", CNCL_PSET_SIZE_6GIRI },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "a3", CNCL_PSET_SIZE_A3 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "square12in", CNCL_PSET_SIZE_SQUARE_12IN },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "b4", CNCL_PSET_SIZE_B4 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "envelopdlp", CNCL_PSET_SIZE_ENV_DL },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "8x10", CNCL_PSET_SIZE_6GIRI },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "letter.bl", CNCL_PSET_SIZE_LETTER },
+	{ "a4", CNCL_PSET_SIZE_A4 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "4x6.bl", CNCL_PSET_SIZE_4X6 },
+	{ NULL, -1 },
+	{ "10x12", CNCL_PSET_SIZE_4GIRI },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "b6", CNCL_PSET_SIZE_B6 },
+	{ "square12in.bl", CNCL_PSET_SIZE_SQUARE_12IN },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ NULL, -1 },
+};
+static const ParamHashTbl papersizeHash = { 11UL, 255UL, papersizeHashSlots };
+
+static const ParamHashSlot colormodeHashSlots[] = {
+	{ "false", CNCL_PSET_COLORMODE_COLOR },
+	{ "true", CNCL_PSET_COLORMODE_MONO },
+	{ NULL, -1 },
+	{ NULL, -1 },
+};
+static const ParamHashTbl colormodeHash = { 0UL, 3UL, colormodeHashSlots };
+
+static const ParamHashSlot duplexprintHashSlots[] = {
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "duplexnotumble", CNCL_PSET_DUPLEX_ON },
+	{ NULL, -1 },
+	{ NULL, -1 },
+	{ "duplextumble", CNCL_PSET_DUPLEX_ON },
+	{ "none", CNCL_PSET_DUPLEX_OFF },
+	{ NULL, -1 },
+};
+static const ParamHashTbl duplexprintHash = { 1UL, 7UL, duplexprintHashSlots };
+
+#endif
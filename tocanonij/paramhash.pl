@@ -0,0 +1,164 @@
+#!/usr/bin/perl
+#
+# Generate include/cncl/cncl_paramhash.h from include/cncl/cncl_paramtbl.h.
+#
+# Every MapTbl becomes an open table indexed by a seeded 32bit FNV-1a hash
+# of the normalized option name. The seed is searched until no two names
+# share a slot, so a lookup is one hash and at most one strcmp.
+# Names are normalized the same way as to_lower_except_size_X() in main.c.
+#
+
+sub is_size_X {
+	my ($str) = @_;
+	my $is_size = 1;
+
+	foreach my $c ( split //, $str ) {
+		last if ( !$is_size || $c eq '.' );
+
+		if ( $is_size == 1 ) {
+			$is_size = ( $c =~ /[0-9]/ ) ? 2 : 0;
+		}
+		elsif ( $is_size == 2 ) {
+			if ( $c eq 'X' ) { $is_size = 3; }
+			elsif ( $c !~ /[0-9]/ ) { $is_size = 0; }
+		}
+		else {
+			$is_size = ( $c =~ /[0-9]/ ) ? 4 : 0;
+		}
+	}
+	return ( $is_size == 4 );
+}
+
+sub normalize {
+	my ($str) = @_;
+	return is_size_X($str) ? $str : lc($str);
+}
+
+sub fnv1a {
+	my ($seed, $str) = @_;
+	my $h = 2166136261 ^ $seed;
+
+	foreach my $c ( unpack( "C*", $str ) ) {
+		$h ^= $c;
+		$h = ( $h * 16777619 ) & 0xffffffff;
+	}
+	return $h;
+}
+
+while(<>) {
+	$paramtbl = $paramtbl.$_;
+}
+
+print <<'EOS';
+/*
+ *  Canon Inkjet Printer Driver for Linux
+ *  Copyright CANON INC. 2001-2024
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * NOTE:
+ *  - As a special exception, this program is permissible to link with the
+ *    libraries released as the binary modules.
+ *  - If you write modifications of your own for these programs, it is your
+ *    choice whether to permit this exception to apply to your modifications.
+ *    If you do not wish that, delete this exception.
+*/
+
+/* Generated by paramhash.sh from cncl_paramtbl.h. Do not edit. */
+
+#ifndef __CNCL_PARAMHASH_H__
+#define __CNCL_PARAMHASH_H__
+
+#include <string.h>
+
+typedef struct {
+	const char *optName;	/* normalized name, NULL for an empty slot */
+	long optNum;
+}ParamHashSlot;
+
+typedef struct {
+	unsigned long seed;
+	unsigned long mask;
+	const ParamHashSlot *slots;
+}ParamHashTbl;
+
+static inline unsigned long ParamHash( unsigned long seed, const char *str )
+{
+	unsigned long h = 2166136261UL ^ seed;
+
+	while( *str ){
+		h ^= (unsigned char)*str++;
+		h = (h * 16777619UL) & 0xffffffffUL;
+	}
+	return h;
+}
+
+/* name must already be normalized (see to_lower_except_size_X) */
+static inline long ParamHashLookup( const ParamHashTbl *tbl, const char *name )
+{
+	const ParamHashSlot *slot = &tbl->slots[ParamHash( tbl->seed, name ) & tbl->mask];
+
+	if ( slot->optName == NULL || strcmp( slot->optName, name ) ) return -1;
+	return slot->optNum;
+}
+EOS
+
+while ( $paramtbl =~ /static\s+const\s+MapTbl\s+(\w+)Tbl\[\]\s*=\s*\{([\w\W]*?)\n\};/g ) {
+	my $name = $1;
+	my $body = $2;
+	my @keys = ();
+	my %num = ();
+
+	while ( $body =~ /\{\s*"([^"]*)"\s*,\s*(\w+)\s*\}/g ) {
+		my $key = normalize($1);
+		next if ( exists $num{$key} );	# first entry wins, as in the linear scan
+		push @keys, $key;
+		$num{$key} = $2;
+	}
+
+	my $size = 1;
+	$size <<= 1 while ( $size < 2 * scalar(@keys) );
+
+	my $seed;
+	my @slots;
+	for ( $seed = 0; ; $seed++ ) {
+		@slots = ();
+		my $ok = 1;
+		foreach my $key ( @keys ) {
+			my $i = fnv1a( $seed, $key ) & ( $size - 1 );
+			if ( defined $slots[$i] ) { $ok = 0; last; }
+			$slots[$i] = $key;
+		}
+		last if ( $ok );
+		if ( $seed == 100000 ) {	# too dense, retry in a larger table
+			$size <<= 1;
+			$seed = -1;
+		}
+	}
+
+	print "\n";
+	print "static const ParamHashSlot ${name}HashSlots[] = {\n";
+	for ( my $i = 0; $i < $size; $i++ ) {
+		if ( defined $slots[$i] ) {
+			print "\t{ \"$slots[$i]\", $num{$slots[$i]} },\n";
+		}
+		else {
+			print "\t{ NULL, -1 },\n";
+		}
+	}
+	print "};\n";
+	printf "static const ParamHashTbl %sHash = { %dUL, %dUL, %sHashSlots };\n", $name, $seed, $size - 1, $name;
+}
+
+print "\n#endif\n";
@@ -0,0 +1,2 @@
+#!/bin/sh
+/usr/bin/perl paramhash.pl <include/cncl/cncl_paramtbl.h >include/cncl/cncl_paramhash.h
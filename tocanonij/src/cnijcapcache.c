@@ -0,0 +1,319 @@
+/*
+ *  Canon Inkjet Printer Driver for Linux
+ *  Copyright CANON INC. 2001-2024
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * NOTE:
+ *  - As a special exception, this program is permissible to link with the
+ *    libraries released as the binary modules.
+ *  - If you write modifications of your own for these programs, it is your
+ *    choice whether to permit this exception to apply to your modifications.
+ *    If you do not wish that, delete this exception.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "cnijcapcache.h"
+
+#define CAPCACHE_DIR_NAME	"cnijfilter2"
+#define CAPCACHE_MAGIC		"CNCAPC01"
+#define CAPCACHE_PATH_LEN	(512)
+#define CAPCACHE_MAX_FILES	(64)	/* per directory, the least recently used go first */
+#define CAPCACHE_TOUCH_SEC	(3600)	/* granularity of the use time */
+
+#define FNV_OFFSET_BASIS	(0xcbf29ce484222325ULL)
+#define FNV_PRIME			(0x100000001b3ULL)
+
+/* cache file: header, decoded string, terminating NUL */
+typedef struct {
+	char		magic[8];
+	int64_t		mtimeSec;
+	int64_t		mtimeNsec;
+	int64_t		ppdSize;
+	uint64_t	ppdHash;
+	int64_t		dataSize;
+} CAPCACHE_HEADER;
+
+static uint64_t HashBytes( uint64_t hash, const unsigned char *p, size_t size )
+{
+	size_t i;
+
+	for ( i = 0; i < size; i++ ) {
+		hash ^= p[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+static int HashPPDFile( int fd, const struct stat *ppdStat, uint64_t *hash )
+{
+	void *mapTop;
+
+	*hash = FNV_OFFSET_BASIS;
+	if ( ppdStat->st_size == 0 ) return 0;
+
+	mapTop = mmap( NULL, ppdStat->st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	if ( mapTop == MAP_FAILED ) return -1;
+
+	*hash = HashBytes( *hash, mapTop, ppdStat->st_size );
+	munmap( mapTop, ppdStat->st_size );
+	return 0;
+}
+
+/* one file per PPD path and key under $CUPS_CACHEDIR */
+static int GetCachePath( const char *ppdName, const char *key, char *path, size_t pathSize )
+{
+	const char *cacheDir = getenv( "CUPS_CACHEDIR" );
+	uint64_t pathHash;
+	int len;
+
+	if ( (cacheDir == NULL) || (*cacheDir == '\0') ) return -1;
+
+	len = snprintf( path, pathSize, "%s/%s", cacheDir, CAPCACHE_DIR_NAME );
+	if ( (len < 0) || ((size_t)len >= pathSize) ) return -1;
+	if ( (mkdir( path, 0755 ) != 0) && (errno != EEXIST) ) return -1;
+
+	pathHash = HashBytes( FNV_OFFSET_BASIS, (const unsigned char *)ppdName, strlen(ppdName) );
+	len = snprintf( path, pathSize, "%s/%s/%016llx-%s", cacheDir, CAPCACHE_DIR_NAME, (unsigned long long)pathHash, key );
+	if ( (len < 0) || ((size_t)len >= pathSize) ) return -1;
+
+	return 0;
+}
+
+static int LookupCache( const char *path, const struct stat *ppdStat, uint64_t ppdHash, CNIJ_CAPCACHE_BLOB *blob )
+{
+	struct stat st;
+	CAPCACHE_HEADER header;
+	void *mapTop = MAP_FAILED;
+	int fd;
+	int result = -1;
+
+	if ( (fd = open( path, O_RDONLY )) < 0 ) return -1;
+	if ( fstat( fd, &st ) != 0 ) goto onErr;
+
+	/* only files written by this user or root, and by nobody else since */
+	if ( (st.st_uid != geteuid()) && (st.st_uid != 0) ) goto onErr;
+	if ( (st.st_mode & (S_IWGRP | S_IWOTH)) != 0 ) goto onErr;
+	if ( st.st_size < (off_t)sizeof(CAPCACHE_HEADER) + 1 ) goto onErr;
+
+	mapTop = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	if ( mapTop == MAP_FAILED ) goto onErr;
+
+	memcpy( &header, mapTop, sizeof(CAPCACHE_HEADER) );
+	if ( memcmp( header.magic, CAPCACHE_MAGIC, sizeof(header.magic) ) != 0 ) goto onErr;
+	if ( (header.mtimeSec != ppdStat->st_mtim.tv_sec) || (header.mtimeNsec != ppdStat->st_mtim.tv_nsec) ) goto onErr;
+	if ( (header.ppdSize != ppdStat->st_size) || (header.ppdHash != ppdHash) ) goto onErr;
+	if ( (header.dataSize <= 0) || (header.dataSize > st.st_size - (off_t)sizeof(CAPCACHE_HEADER) - 1) ) goto onErr;
+
+	blob->data = (uint8_t *)mapTop + sizeof(CAPCACHE_HEADER);
+	blob->size = header.dataSize;
+	blob->mapTop = mapTop;
+	blob->mapSize = st.st_size;
+	result = 0;
+
+	/* the modification time orders the files for EvictCache */
+	if ( st.st_mtime + CAPCACHE_TOUCH_SEC < time( NULL ) ) {
+		futimens( fd, NULL );
+	}
+onErr:
+	if ( (result != 0) && (mapTop != MAP_FAILED) ) {
+		munmap( mapTop, st.st_size );
+	}
+	close( fd );
+	return result;
+}
+
+static int WriteAll( int fd, const void *buf, size_t size )
+{
+	const char *p = buf;
+	ssize_t written;
+
+	while ( size > 0 ) {
+		written = write( fd, p, size );
+		if ( written < 0 ) {
+			if ( errno == EINTR ) continue;
+			return -1;
+		}
+		p += written;
+		size -= written;
+	}
+	return 0;
+}
+
+/* write a new cache file next to the old one and swap it in */
+static void StoreCache( const char *path, const struct stat *ppdStat, uint64_t ppdHash, const uint8_t *data, int size )
+{
+	char tmpPath[CAPCACHE_PATH_LEN];
+	CAPCACHE_HEADER header;
+	int fd;
+
+	if ( snprintf( tmpPath, sizeof(tmpPath), "%s.XXXXXX", path ) >= (int)sizeof(tmpPath) ) return;
+	if ( (fd = mkstemp( tmpPath )) < 0 ) return;
+
+	memset( &header, 0, sizeof(CAPCACHE_HEADER) );
+	memcpy( header.magic, CAPCACHE_MAGIC, sizeof(header.magic) );
+	header.mtimeSec = ppdStat->st_mtim.tv_sec;
+	header.mtimeNsec = ppdStat->st_mtim.tv_nsec;
+	header.ppdSize = ppdStat->st_size;
+	header.ppdHash = ppdHash;
+	header.dataSize = size;
+
+	if ( (fchmod( fd, 0644 ) != 0)
+	  || (WriteAll( fd, &header, sizeof(CAPCACHE_HEADER) ) != 0)
+	  || (WriteAll( fd, data, size ) != 0)
+	  || (WriteAll( fd, "", 1 ) != 0) ) {
+		close( fd );
+		unlink( tmpPath );
+		return;
+	}
+	close( fd );
+
+	if ( rename( tmpPath, path ) != 0 ) {
+		unlink( tmpPath );
+	}
+}
+
+/* cache files are named after the 16 digit hash of their PPD path */
+static int IsCacheFile( const char *name )
+{
+	int i;
+
+	for ( i = 0; i < 16; i++ ) {
+		if ( !isxdigit( (unsigned char)name[i] ) ) return 0;
+	}
+	return ( name[16] == '-' );
+}
+
+/* keep at most CAPCACHE_MAX_FILES cache files, remove the oldest */
+static void EvictCache( const char *path )
+{
+	char dirPath[CAPCACHE_PATH_LEN];
+	char filePath[CAPCACHE_PATH_LEN];
+	char oldestPath[CAPCACHE_PATH_LEN];
+	char *slash;
+	DIR *dir;
+	struct dirent *ent;
+	struct stat st;
+	time_t oldest;
+	int count;
+
+	if ( snprintf( dirPath, sizeof(dirPath), "%s", path ) >= (int)sizeof(dirPath) ) return;
+	if ( (slash = strrchr( dirPath, '/' )) == NULL ) return;
+	*slash = '\0';
+
+	for ( ;; ) {
+		if ( (dir = opendir( dirPath )) == NULL ) return;
+		count = 0;
+		oldest = 0;
+		oldestPath[0] = '\0';
+		while ( (ent = readdir( dir )) != NULL ) {
+			if ( !IsCacheFile( ent->d_name ) ) continue;
+			if ( snprintf( filePath, sizeof(filePath), "%s/%s", dirPath, ent->d_name ) >= (int)sizeof(filePath) ) continue;
+			if ( (lstat( filePath, &st ) != 0) || !S_ISREG( st.st_mode ) ) continue;
+			count++;
+			if ( (oldestPath[0] == '\0') || (st.st_mtime < oldest) ) {
+				oldest = st.st_mtime;
+				strcpy( oldestPath, filePath );
+			}
+		}
+		closedir( dir );
+
+		if ( count <= CAPCACHE_MAX_FILES ) return;
+		if ( unlink( oldestPath ) != 0 ) return;
+	}
+}
+
+/* stat and hash of the PPD the cache entries are checked against */
+static int StatPPD( const char *ppdName, struct stat *ppdStat, uint64_t *ppdHash )
+{
+	int fd;
+	int result = -1;
+
+	if ( (fd = open( ppdName, O_RDONLY )) < 0 ) return -1;
+	if ( (fstat( fd, ppdStat ) == 0) && (HashPPDFile( fd, ppdStat, ppdHash ) == 0) ) {
+		result = 0;
+	}
+	close( fd );
+	return result;
+}
+
+int CapCacheLookup( const char *ppdName, const char *key, CNIJ_CAPCACHE_BLOB *blob )
+{
+	char path[CAPCACHE_PATH_LEN];
+	struct stat ppdStat;
+	uint64_t ppdHash;
+
+	memset( blob, 0, sizeof(CNIJ_CAPCACHE_BLOB) );
+
+	if ( (ppdName == NULL) || (strchr( key, '/' ) != NULL) ) return -1;
+	if ( GetCachePath( ppdName, key, path, sizeof(path) ) != 0 ) return -1;
+	if ( StatPPD( ppdName, &ppdStat, &ppdHash ) != 0 ) return -1;
+	if ( LookupCache( path, &ppdStat, ppdHash, blob ) != 0 ) return -1;
+
+	return blob->size;
+}
+
+void CapCacheStore( const char *ppdName, const char *key, const uint8_t *data, int size )
+{
+	char path[CAPCACHE_PATH_LEN];
+	struct stat ppdStat;
+	uint64_t ppdHash;
+
+	if ( (ppdName == NULL) || (data == NULL) || (size <= 0) || (strchr( key, '/' ) != NULL) ) return;
+	if ( GetCachePath( ppdName, key, path, sizeof(path) ) != 0 ) return;
+	if ( StatPPD( ppdName, &ppdStat, &ppdHash ) != 0 ) return;
+
+	StoreCache( path, &ppdStat, ppdHash, data, size );
+	EvictCache( path );
+}
+
+int CapCacheGetStringWithTag( CNIJ_GETSTRINGWITHTAG getString, const char *ppdName, const char *tagName, int decode, CNIJ_CAPCACHE_BLOB *blob )
+{
+	char key[CAPCACHE_PATH_LEN];
+	int size;
+
+	snprintf( key, sizeof(key), "%s-%d", tagName, decode );
+	if ( CapCacheLookup( ppdName, key, blob ) > 0 ) {
+		return blob->size;
+	}
+
+	size = getString( ppdName, tagName, decode, &blob->data );
+	if ( (size > 0) && (blob->data != NULL) ) {
+		blob->size = size;
+		CapCacheStore( ppdName, key, blob->data, size );
+	}
+	return size;
+}
+
+void CapCacheRelease( CNIJ_CAPCACHE_BLOB *blob )
+{
+	if ( blob->mapTop != NULL ) {
+		munmap( blob->mapTop, blob->mapSize );
+	}
+	else if ( blob->data != NULL ) {
+		free( blob->data );
+	}
+	memset( blob, 0, sizeof(CNIJ_CAPCACHE_BLOB) );
+}
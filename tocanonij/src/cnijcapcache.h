@@ -0,0 +1,58 @@
+/*
+ *  Canon Inkjet Printer Driver for Linux
+ *  Copyright CANON INC. 2001-2024
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * NOTE:
+ *  - As a special exception, this program is permissible to link with the
+ *    libraries released as the binary modules.
+ *  - If you write modifications of your own for these programs, it is your
+ *    choice whether to permit this exception to apply to your modifications.
+ *    If you do not wish that, delete this exception.
+*/
+
+#ifndef _CNIJCAPCACHE_H_
+#define _CNIJCAPCACHE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* CNCL_GetStringWithTagFromFile */
+typedef int (*CNIJ_GETSTRINGWITHTAG)( const char*, const char*, int, uint8_t** );
+
+/* decoded PPD string, read only when it comes from the cache */
+typedef struct {
+	uint8_t	*data;
+	int		size;
+	void	*mapTop;	/* cache file mapping, NULL when data is malloc'd */
+	size_t	mapSize;
+} CNIJ_CAPCACHE_BLOB;
+
+/*
+ * Same result as getString( ppdName, tagName, decode, &blob->data ),
+ * served from $CUPS_CACHEDIR/cnijfilter2 while the PPD is unchanged.
+ * Release the blob with CapCacheRelease instead of free.
+ */
+int CapCacheGetStringWithTag( CNIJ_GETSTRINGWITHTAG getString, const char *ppdName, const char *tagName, int decode, CNIJ_CAPCACHE_BLOB *blob );
+void CapCacheRelease( CNIJ_CAPCACHE_BLOB *blob );
+
+/*
+ * Blob stored under key for ppdName, good while the PPD is unchanged.
+ * Returns its size, -1 when there is none. The key names the cache file.
+ */
+int CapCacheLookup( const char *ppdName, const char *key, CNIJ_CAPCACHE_BLOB *blob );
+void CapCacheStore( const char *ppdName, const char *key, const uint8_t *data, int size );
+
+#endif
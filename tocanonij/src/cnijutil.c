@@ -26,19 +26,12 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include <dlfcn.h>
 
 #include "cnijutil.h"
+#include "cnijcapcache.h"
+#include "cnijcncl.h"
 #include "cnijifnet2.h"
 
-#define CN_CNCL_LIB_PATH		("libcnbpcnclapi%s.so")
-#define CN_LIB_PATH_LEN 512
-#define CN_CNCL_LIBNAME "libcnbpcnclapicom2.so"
-
-
-static int (*GetStringWithTagFromFile)(const char*, const char*, int, uint8_t**);
-// static int (*GetStringWithTagFromFile)(const char*, const char*, int*, uint8_t**);
-// static int (*CNCL_GetStringWithTagFromFile)(const char*, const char*, size_t, uint8_t**);
 
 
 
@@ -61,32 +54,18 @@ int GetUUID( char *arg , char *uuid ){
 
 int GetCapabilityFromPPDFile(const char *ppdFileName, CAPABILITY_DATA *_data)
 {
-	char libPathBuf[CN_LIB_PATH_LEN];
-	void *libclss = NULL;
-	char model_number[] = "com2";
-
-	// snprintf( libPathBuf, CN_LIB_PATH_LEN, "%s%s", optarg, CN_CNCL_LIBNAME );
-	snprintf( libPathBuf, CN_LIB_PATH_LEN - 1, CN_CNCL_LIB_PATH, model_number );
-	// snprintf( libPathBuf, CN_LIB_PATH_LEN, "%s", CN_CNCL_LIBNAME );
-
-	libclss = dlopen( libPathBuf, RTLD_LAZY );
-	if ( !libclss ) {
-		fprintf( stderr, "Error in dlopen\n" );
-		goto onErr;
-	}
-
-	GetStringWithTagFromFile = NULL;
-	GetStringWithTagFromFile = dlsym( libclss, "CNCL_GetStringWithTagFromFile" );
+	CNCL_TYPE_GetStringWithTagFromFile GetStringWithTagFromFile;
 
-	if ( dlerror() != NULL ) {
-		fprintf( stderr, "Error in CNCL_GetSetConfigurationCommand. API not Found.\n" );
+	/* the process wide CNCL handle, opened on first use */
+	if ( (GetStringWithTagFromFile = CNCL_API( GetStringWithTagFromFile )) == NULL ) {
 		goto onErr;
 	}
 
 	// char *buffer = NULL;
 	uint8_t *buffer = NULL;
+	CNIJ_CAPCACHE_BLOB blob;
 
-	unsigned int bufferSize = 0;
+	int bufferSize = 0;
 
 	// char version[16];
 	// memset(version, 0, sizeof(version));
@@ -103,9 +82,11 @@ int GetCapabilityFromPPDFile(const char *ppdFileName, CAPABILITY_DATA *_data)
 	// bufferSize = GetStringWithTagFromFile(ppdFileName, CNCL_FILE_TAG_DEVICEID, CNCL_DECODE_EXEC, buffer);
 
 	// bufferSize = GetStringWithTagFromFile(ppdFileName, CNCL_FILE_TAG_DEVICEID, (size_t *)1, buffer);
-	bufferSize = GetStringWithTagFromFile(ppdFileName, CNCL_FILE_TAG_DEVICEID, 1, &buffer);
+	bufferSize = CapCacheGetStringWithTag(GetStringWithTagFromFile, ppdFileName, CNCL_FILE_TAG_DEVICEID, 1, &blob);
+	buffer = blob.data;
 
 	if( bufferSize <= 0 ){
+		CapCacheRelease(&blob);
 		return MAKEPPD_FAILED;
 	}
 
@@ -113,6 +94,7 @@ int GetCapabilityFromPPDFile(const char *ppdFileName, CAPABILITY_DATA *_data)
 	temp = (uint8_t *) malloc(1024);
 
 	if( temp == NULL ){
+		CapCacheRelease(&blob);
 		goto onErr;
 	}
 
@@ -127,6 +109,7 @@ int GetCapabilityFromPPDFile(const char *ppdFileName, CAPABILITY_DATA *_data)
 			j++;
 		}
 	}
+	CapCacheRelease(&blob);
 
 	_data->deviceID = temp;
 	_data->deviceIDLength = strlen( (char *)temp );
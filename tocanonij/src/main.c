@@ -23,14 +23,19 @@
  *    If you do not wish that, delete this exception.
 */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include <getopt.h>
-#include <dlfcn.h>
 #include <errno.h>
 #include <time.h>
 //#include "cncl.h"
@@ -38,7 +43,7 @@
 #include "cnclcmdutilsdef.h"
 #include "cndata_def.h"
 #include "com_def.h"
-#include "cncl_paramtbl.h"
+#include "cncl_paramhash.h"
 
 #define CN_LIB_PATH_LEN 512
 #define CN_CNCL_LIBNAME "libcnbpcnclapicom2.so"
@@ -49,18 +54,52 @@
 #define CNIJ_TEMP "/var/tmp/cnijcachetmpXXXXXX"
 #define OPTION_TRUE "true"
 
-#define COLOR_MODE_COUNT 2
-
 // #include "ivec.h"
 #include "cnijutil.h"
-
-int (*CNCL_GetString)(const char*, const char*, int, uint8_t**);
-int WriteHeader(int fd, char jobID[], char uuid[], CNCL_P_SETTINGSPTR Settings, CAPABILITY_DATA capability);
-int WriteData(int in_fd, int out_fds[], char jobID[], enum ColorMode *jobColorMode);
-int WritePages(int in_fd, int out_fd, char jobID[]);
-int WriteTail(int out_fd, char jobID[]);
-void CreateCacheFile(int out_fds[]);
-int ReplayCacheFile(int in_fd, int out_fd);
+#include "pwggray.h"
+#include "cnijcapcache.h"
+#include "cnijcncl.h"
+
+/* buffers shared by every command of one job */
+typedef struct {
+	char	*cmdBuf;		/* CNCL command output */
+	long	cmdBufSize;
+	char	*dataBuf;		/* page data relay */
+	long	dataBufSize;
+	uint8_t	*xmlBuf;		/* decoded CNIJ-IVEC-CAPABILITY, read only */
+	int		xmlBufSize;
+	CNIJ_CAPCACHE_BLOB	xmlBlob;
+	const char	*ppdName;
+} CNIJ_JOB_CONTEXT;
+
+/* header commands of a job, followed by size bytes of command data */
+typedef struct {
+	char	magic[8];
+	long	size;
+	long	setTimeFirst;	/* legacy protocol, OutputSetTime is written live before */
+	long	uuidOffset;		/* -1 when there is no uuid to patch */
+	long	uuidLength;
+	long	timeOffset;		/* -1 without SetJobConfiguration */
+} CNIJ_HEADER_TEMPLATE;
+
+/* what MakeHeaderTemplate generates the commands from */
+typedef struct {
+	CNIJ_JOB_CONTEXT	*ctx;
+	char	*jobID;
+	char	*uuid;
+	CNCL_P_SETTINGSPTR	Settings;
+	int		prot;
+	int		exact;		/* this job only, do not mark the variable fields */
+} CNIJ_HEADER_SOURCE;
+
+int InitJobContext(CNIJ_JOB_CONTEXT *ctx, const char *ppdName);
+void FreeJobContext(CNIJ_JOB_CONTEXT *ctx);
+int WriteHeader(CNIJ_JOB_CONTEXT *ctx, int fd, char jobID[], char uuid[], CNCL_P_SETTINGSPTR Settings, CAPABILITY_DATA capability);
+int WriteData(CNIJ_JOB_CONTEXT *ctx, int in_fd, int out_fds[], char jobID[]);
+int WritePages(CNIJ_JOB_CONTEXT *ctx, int in_fd, int out_fd, char jobID[]);
+int WriteTail(CNIJ_JOB_CONTEXT *ctx, int out_fd, char jobID[]);
+int CreateCacheFile(void);
+int ReplayCacheFile(CNIJ_JOB_CONTEXT *ctx, int in_fd, int out_fd, char jobID[], enum ColorMode jobColorMode);
 int GetJobId(char jobID[], CAPABILITY_DATA capability);
 
 enum {
@@ -74,7 +113,8 @@ enum {
 	OPT_JOBID,
 	OPT_UUID,
 	OPT_ROTATE180,
-	OPT_OPTIMIZATION
+	OPT_OPTIMIZATION,
+	OPT_BANDLINES
 };
 
 static int is_size_X(char *str)
@@ -127,28 +167,18 @@ static void to_lower_except_size_X(char *str)
 	}
 }
 
-static long ConvertStrToID( const char *str, const MapTbl *tbl )
+static long ConvertStrToID( const char *str, const ParamHashTbl *tbl )
 {
 	int result = -1;
-	const MapTbl *cur = tbl;
 	char srcBuf[TMP_BUF_SIZE];
-	char dstBuf[TMP_BUF_SIZE];
-
-	if ( cur == NULL ) goto onErr;
 
-	while( cur->optNum != -1 ){
-		strncpy( srcBuf, str, TMP_BUF_SIZE ); srcBuf[TMP_BUF_SIZE-1] = '\0';
-		to_lower_except_size_X(srcBuf);
+	if ( tbl == NULL ) goto onErr;
 
-		strncpy( dstBuf, cur->optName, TMP_BUF_SIZE ); dstBuf[TMP_BUF_SIZE-1] = '\0';
-		to_lower_except_size_X(dstBuf);
+	/* table names are normalized by paramhash.pl, so only the input is */
+	strncpy( srcBuf, str, TMP_BUF_SIZE ); srcBuf[TMP_BUF_SIZE-1] = '\0';
+	to_lower_except_size_X(srcBuf);
 
-		if ( !strcmp( dstBuf, srcBuf ) ){
-			result = cur->optNum;
-			break;
-		}
-		cur++;
-	}
+	result = ParamHashLookup( tbl, srcBuf );
 
 onErr:
 	return result;
@@ -217,17 +247,32 @@ onErr:
 
 
 /* define CNCL API */
-static int (*GETSETCONFIGURATIONCOMMAND)( CNCL_P_SETTINGSPTR, char *, long ,void *, long, char *, long * );
-static int (*GETSENDDATAPWGRASTERCOMMAND)( char *, long, long, char *, long * );
-static int (*GETPRINTCOMMAND)( char *, long, long *, char *, long );
-static int (*GETSTRINGWITHTAGFROMFILE)( const char* , const char* , int* , uint8_t** );
-static int (*GETSETPAGECONFIGUARTIONCOMMAND)( const char* , unsigned short , void * , long, long * );
-static int (*MAKEBJLSETTIMEJOB)( void*, size_t, size_t* );
-static int (*GetProtocol)(char *, size_t);
-static int (*ParseCapabilityResponsePrint_HostEnv)(void *, int);
-static int (*MakeCommand_StartJob3)(int, char *, char[], void *, int, int *);
-static int (*ParseCapabilityResponsePrint_DateTime)(void *, int);
-static int (*MakeCommand_SetJobConfiguration)(char[], char[], void *, int, int *);
+#define GETSETCONFIGURATIONCOMMAND				CNCL_API( GetSetConfigurationCommand )
+#define GETSENDDATAPWGRASTERCOMMAND				CNCL_API( GetSendDataPWGRasterCommand )
+#define GETPRINTCOMMAND							CNCL_API( GetPrintCommand )
+#define GETSTRINGWITHTAGFROMFILE				CNCL_API( GetStringWithTagFromFile )
+#define GETSETPAGECONFIGUARTIONCOMMAND			CNCL_API( GetSetPageConfigurationCommand )
+#define MAKEBJLSETTIMEJOB						CNCL_API( MakeBJLSetTimeJob )
+#define GetProtocol								CNCL_API( GetProtocol )
+#define ParseCapabilityResponsePrint_HostEnv	CNCL_API( ParseCapabilityResponsePrint_HostEnv )
+#define MakeCommand_StartJob3					CNCL_API( MakeCommand_StartJob3 )
+#define ParseCapabilityResponsePrint_DateTime	CNCL_API( ParseCapabilityResponsePrint_DateTime )
+#define MakeCommand_SetJobConfiguration			CNCL_API( MakeCommand_SetJobConfiguration )
+
+/* every entry point tocanonij calls, checked before the job starts */
+static const int cnclRequired[] = {
+	CNCL_ID_GetSetConfigurationCommand,
+	CNCL_ID_GetSendDataPWGRasterCommand,
+	CNCL_ID_GetPrintCommand,
+	CNCL_ID_GetStringWithTagFromFile,
+	CNCL_ID_GetSetPageConfigurationCommand,
+	CNCL_ID_MakeBJLSetTimeJob,
+	CNCL_ID_GetProtocol,
+	CNCL_ID_ParseCapabilityResponsePrint_HostEnv,
+	CNCL_ID_MakeCommand_StartJob3,
+	CNCL_ID_ParseCapabilityResponsePrint_DateTime,
+	CNCL_ID_MakeCommand_SetJobConfiguration,
+};
 
 
 /* CN_START_JOBID */
@@ -235,383 +280,858 @@ static int (*MakeCommand_SetJobConfiguration)(char[], char[], void *, int, int *
 #define CN_START_JOBID			("00000001")
 #define CN_START_JOBID2			("00000002")
 #define CN_START_JOBID_LEN		(9)
+#define CN_SPLICE_SIZE			(1024 * 1024)
+
+/* WriteCacheFile result */
+#define WRITEDATA_COLOR_JOB		(1)
+
+/* header template */
+#define CN_HEADER_TEMPLATE_MAGIC	"CNHDRT01"
+#define CN_HEADER_TEMPLATE_KEY		"CNIJ-HEADER"
+#define CN_DATETIME_LEN				(14)
 
 // #define DEBUG_LOG
 
-int OutputSetTime( int fd, char *jobID )
+int InitJobContext( CNIJ_JOB_CONTEXT *ctx, const char *ppdName )
 {
-	long bufSize, retSize, writtenSize;
-	char *bufTop = NULL;
-	int result  = -1;
+	int result = -1;
+
+	memset( ctx, 0, sizeof(CNIJ_JOB_CONTEXT) );
+	ctx->ppdName = ppdName;
+
+	/* Decode capability once for the whole job, or take it from the cache */
+	if ( (ctx->xmlBufSize = CapCacheGetStringWithTag( GETSTRINGWITHTAGFROMFILE, ppdName, CNCL_FILE_TAG_CAPABILITY, CNCL_DECODE_EXEC, &ctx->xmlBlob )) < 0 ){
+		DEBUG_PRINT2( "[tocanonij] p_ppd_name : %s\n", ppdName );
+		DEBUG_PRINT2( "[tocanonij] xmlBufSize : %d\n", ctx->xmlBufSize );
+		fprintf( stderr, "Error in CNCL_GetStringWithTagFromFile\n" );
+		goto onErr;
+	}
+	ctx->xmlBuf = ctx->xmlBlob.data;
+
+	/* SetConfiguration grows with the capability, keep room for it */
+	ctx->cmdBufSize = sizeof(char) * CN_BUFSIZE;
+	if ( ctx->cmdBufSize < (long)ctx->xmlBufSize * 2 ) {
+		ctx->cmdBufSize = (long)ctx->xmlBufSize * 2;
+	}
+	ctx->dataBufSize = sizeof(char) * CN_BUFSIZE;
+
+	if ( (ctx->cmdBuf = malloc( ctx->cmdBufSize )) == NULL ) goto onErr;
+	if ( (ctx->dataBuf = malloc( ctx->dataBufSize )) == NULL ) goto onErr;
+	DEBUG_PRINT2( "[tocanonij] cmdBufSize : %ld\n", ctx->cmdBufSize );
+
+	result = 0;
+onErr:
+	if ( result != 0 ) {
+		FreeJobContext( ctx );
+	}
+	return result;
+}
+
+void FreeJobContext( CNIJ_JOB_CONTEXT *ctx )
+{
+	if ( ctx->cmdBuf != NULL ) {
+		free( ctx->cmdBuf );
+	}
+	if ( ctx->dataBuf != NULL ) {
+		free( ctx->dataBuf );
+	}
+	CapCacheRelease( &ctx->xmlBlob );
+	memset( ctx, 0, sizeof(CNIJ_JOB_CONTEXT) );
+}
+
+/* write all iovec entries, retrying on short writes */
+static int WriteVector( int fd, struct iovec *iov, int iovcnt )
+{
+	ssize_t writeBytes;
+
+	while ( iovcnt > 0 ) {
+		if ( iov->iov_len == 0 ) {
+			iov++;
+			iovcnt--;
+			continue;
+		}
+
+		writeBytes = writev( fd, iov, iovcnt );
+		if ( writeBytes < 0 ) {
+			if ( errno == EINTR ) continue;
+			return -1;
+		}
+
+		while ( (iovcnt > 0) && ((size_t)writeBytes >= iov->iov_len) ) {
+			writeBytes -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if ( iovcnt > 0 ) {
+			iov->iov_base = (char *)iov->iov_base + writeBytes;
+			iov->iov_len -= writeBytes;
+		}
+	}
+
+	return 0;
+}
 
-	/* Allocate Buffer */
-	bufSize = sizeof(char) * CN_BUFSIZE;
-	if ( (bufTop = malloc( bufSize )) == NULL ) goto onErr;
+int OutputSetTime( CNIJ_JOB_CONTEXT *ctx, int fd, char *jobID )
+{
+	long bufSize = ctx->cmdBufSize;
+	long writtenSize;
+	char *bufTop = ctx->cmdBuf;
+	int result  = -1;
 
 	/* StartJob1 */
-	if ( GETPRINTCOMMAND == NULL ) goto onErr;
 	if ( GETPRINTCOMMAND( bufTop, bufSize, &writtenSize, jobID, CNCL_COMMAND_START1 ) != 0 ) {
 		fprintf( stderr, "Error in OutputSetTime\n" );
 		goto onErr;
 	}
-	if ( (retSize = write( fd, bufTop, writtenSize )) != writtenSize ) goto onErr;
+	if ( write( fd, bufTop, writtenSize ) != writtenSize ) goto onErr;
 
 	/* StartJob2 */
 	if ( GETPRINTCOMMAND( bufTop, bufSize, &writtenSize, jobID, CNCL_COMMAND_START2 ) != 0 ) {
 		fprintf( stderr, "Error in OutputSetTime\n" );
 		goto onErr;
 	}
-	if ( (retSize = write( fd, bufTop, writtenSize )) != writtenSize ) goto onErr;
+	if ( write( fd, bufTop, writtenSize ) != writtenSize ) goto onErr;
 
 	/* SetTime */
-	if ( MAKEBJLSETTIMEJOB == NULL ) goto onErr;
 	if ( MAKEBJLSETTIMEJOB( bufTop, (size_t)bufSize, (size_t *)&writtenSize ) != 0 ) {
 		fprintf( stderr, "Error in OutputSetTime\n" );
 		goto onErr;
 	}
-	if ( (retSize = write( fd, bufTop, writtenSize )) != writtenSize ) goto onErr;
+	if ( write( fd, bufTop, writtenSize ) != writtenSize ) goto onErr;
 
 	/* EndJob */
 	if ( GETPRINTCOMMAND( bufTop, bufSize, &writtenSize, jobID, CNCL_COMMAND_END ) != 0 ) {
 		fprintf( stderr, "Error in OutputSetTime\n" );
 		goto onErr;
 	}
-	if ( (retSize = write( fd, bufTop, writtenSize )) != writtenSize ) goto onErr;
+	if ( write( fd, bufTop, writtenSize ) != writtenSize ) goto onErr;
 
 	result = 0;
 onErr:
-	if ( bufTop != NULL ) {
-		free( bufTop );
-	}
 	return result;
 }
 
-int WriteHeader(int fd, char jobID[], char uuid[], CNCL_P_SETTINGSPTR Settings, CAPABILITY_DATA capability)
+/* host time for SetJobConfiguration, YYYYMMDDhhmmss */
+static void MakeDateTime( char dateTime[CN_DATETIME_LEN + 1] )
 {
-	DEBUG_PRINT( "[tocanonij] WriteHeader\n");
-	uint8_t *xmlBuf = NULL;
-	int xmlBufSize;
-	int writtenSize = 0;
-	long writtenSize_long = 0;
-	const char *p_ppd_name = getenv("PPD");
-
-	long bufSize = sizeof(char) * CN_BUFSIZE;
-	char *bufTop = NULL;
-	char *tmpBuf = NULL;
+	time_t timer = time(NULL);
+	struct tm *date = localtime(&timer);
 
-	if ( (bufTop = malloc( bufSize )) == NULL ){
-		return -1;
-	}
+	snprintf(dateTime, CN_DATETIME_LEN + 1, "%d%02d%02d%02d%02d%02d",
+		date->tm_year+1900, date->tm_mon+1, date->tm_mday,
+		date->tm_hour, date->tm_min, date->tm_sec);
+}
 
-	int prot = GetProtocol( (char *)capability.deviceID, capability.deviceIDLength );
+static uint64_t HashTemplateKey( uint64_t hash, const void *p, size_t size )
+{
+	const unsigned char *bytes = p;
+	size_t i;
 
-	if( prot == 2 ){
-		xmlBufSize = GETSTRINGWITHTAGFROMFILE( p_ppd_name, CNCL_FILE_TAG_CAPABILITY, (int *)CNCL_DECODE_EXEC, &xmlBuf );
+	for ( i = 0; i < size; i++ ) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
 
-		unsigned short hostEnv = 0;
-		hostEnv = ParseCapabilityResponsePrint_HostEnv( xmlBuf, xmlBufSize );
+/* offset of the only occurrence of str in buf, -1 when missing or ambiguous */
+static long FindPatchField( const char *buf, long size, const char *str, long len )
+{
+	const char *first;
 
-		/* Write StartJob Command */
-		int ret = 0;
-		ret = MakeCommand_StartJob3( hostEnv, uuid, jobID, bufTop, bufSize, &writtenSize );
+	if ( len == 0 ) return -1;
+	if ( (first = memmem( buf, size, str, len )) == NULL ) return -1;
+	if ( memmem( first + 1, size - (first + 1 - buf), str, len ) != NULL ) return -1;
+	return first - buf;
+}
 
-		if ( ret != 0 ) {
-			fprintf( stderr, "Error in CNCL_GetPrintCommand\n" );
-			free(bufTop);
-			return -1;
-		}
+static int AppendTemplate( uint8_t **tpl, long *tplSize, const char *cmd, long cmdSize )
+{
+	uint8_t *grown = realloc( *tpl, *tplSize + cmdSize );
 
-		/* WriteData */
-		if (  write( fd, bufTop, writtenSize ) != writtenSize ){
-			free(bufTop);
-			return -1;
-		} 
+	if ( grown == NULL ) return -1;
+	memcpy( grown + *tplSize, cmd, cmdSize );
+	*tpl = grown;
+	*tplSize += cmdSize;
+	return 0;
+}
 
-		char dateTime[15];
-		memset(dateTime, '\0', sizeof(dateTime));
+/*
+ * Generate the header commands of src through CNCL and mark where the uuid
+ * and the datetime went, the marked fields are blanked so no job's values
+ * end up in the cache. Fails when a field cannot be located unambiguously;
+ * with exact set nothing is marked and the commands are only good for the
+ * current job.
+ */
+static int MakeHeaderTemplate( CNIJ_HEADER_SOURCE *src, CNIJ_CAPCACHE_BLOB *blob )
+{
+	CNIJ_JOB_CONTEXT *ctx = src->ctx;
+	CNIJ_HEADER_TEMPLATE header;
+	char *bufTop = ctx->cmdBuf;
+	long bufSize = ctx->cmdBufSize;
+	unsigned int writtenSize = 0;
+	long writtenSize_long = 0;
+	uint8_t *tpl = NULL;
+	long tplSize = sizeof(CNIJ_HEADER_TEMPLATE);
+	long uuidLength = strlen( src->uuid );
+	int result = -1;
 
-		ret = ParseCapabilityResponsePrint_DateTime( xmlBuf, xmlBufSize );
+	memset( &header, 0, sizeof(header) );
+	memcpy( header.magic, CN_HEADER_TEMPLATE_MAGIC, sizeof(header.magic) );
+	header.uuidOffset = -1;
+	header.uuidLength = uuidLength;
+	header.timeOffset = -1;
+	if ( (tpl = malloc( tplSize )) == NULL ) goto onErr;
 
-		if( ret == 2 ){
-			time_t timer = time(NULL);
-			struct tm *date = localtime(&timer);
+	if( src->prot == 2 ){
+		unsigned short hostEnv = 0;
+		hostEnv = ParseCapabilityResponsePrint_HostEnv( ctx->xmlBuf, ctx->xmlBufSize );
 
-			sprintf(dateTime, "%d%02d%02d%02d%02d%02d",
-				date->tm_year+1900, date->tm_mon+1, date->tm_mday,
-				date->tm_hour, date->tm_min, date->tm_sec);
+		/* StartJob */
+		if ( MakeCommand_StartJob3( hostEnv, src->uuid, src->jobID, bufTop, bufSize, &writtenSize ) != 0 ) {
+			fprintf( stderr, "Error in CNCL_GetPrintCommand\n" );
+			goto onErr;
+		}
+		if ( (uuidLength > 0) && !src->exact ) {
+			if ( (header.uuidOffset = FindPatchField( bufTop, writtenSize, src->uuid, uuidLength )) < 0 ) goto onErr;
+			header.uuidOffset += tplSize - sizeof(CNIJ_HEADER_TEMPLATE);
+		}
+		if ( AppendTemplate( &tpl, &tplSize, bufTop, writtenSize ) != 0 ) goto onErr;
 
-			if ( (tmpBuf = malloc( bufSize )) == NULL ){
-				free(tmpBuf);
-				return -1;
-			}
+		if( ParseCapabilityResponsePrint_DateTime( ctx->xmlBuf, ctx->xmlBufSize ) == 2 ){
+			char dateTime[CN_DATETIME_LEN + 1];
 
-			MakeCommand_SetJobConfiguration( jobID, dateTime, tmpBuf, bufSize, &writtenSize );
+			MakeDateTime( dateTime );
+			MakeCommand_SetJobConfiguration( src->jobID, dateTime, bufTop, bufSize, &writtenSize );
 
-			/* WriteData */
-			if ( write( fd, tmpBuf, writtenSize ) != writtenSize ){
-				free(bufTop);
-				free(tmpBuf);
-				return -1;
+			if ( !src->exact ) {
+				if ( (header.timeOffset = FindPatchField( bufTop, writtenSize, dateTime, CN_DATETIME_LEN )) < 0 ) goto onErr;
+				header.timeOffset += tplSize - sizeof(CNIJ_HEADER_TEMPLATE);
 			}
-			
-			free(tmpBuf);
-			// writtenSize += tmpWrittenSize;
+			if ( AppendTemplate( &tpl, &tplSize, bufTop, writtenSize ) != 0 ) goto onErr;
 		}
 	}
 	else{
-		/* OutputSetTime */
-		if ( OutputSetTime( fd, jobID ) != 0 ){
-			free(bufTop);
-			return -1;
-		}
+		/* SetTime carries the current time in its own encoding, it stays live */
+		header.setTimeFirst = 1;
 
-		/* Write StartJob Command */
-		if ( GETPRINTCOMMAND( bufTop, bufSize, &writtenSize_long, jobID, CNCL_COMMAND_START1 ) != 0 ) {
+		/* StartJob */
+		if ( GETPRINTCOMMAND( bufTop, bufSize, &writtenSize_long, src->jobID, CNCL_COMMAND_START1 ) != 0 ) {
 			fprintf( stderr, "Error in CNCL_GetPrintCommand\n" );
-			free(bufTop);
-			return -1;
+			goto onErr;
 		}
+		if ( AppendTemplate( &tpl, &tplSize, bufTop, writtenSize_long ) != 0 ) goto onErr;
+	}
 
-		/* WriteData */
-		if ( write( fd, bufTop, writtenSize_long ) != writtenSize_long ){
-			free(bufTop);
-			return -1;
-		}
+	/* SetConfiguration */
+	if ( GETSETCONFIGURATIONCOMMAND( src->Settings, src->jobID, bufSize, (void *)ctx->xmlBuf, ctx->xmlBufSize, bufTop, &writtenSize_long ) != 0 ){
+		fprintf( stderr, "Error in CNCL_GetSetConfigurationCommand\n" );
+		goto onErr;
 	}
+	if ( AppendTemplate( &tpl, &tplSize, bufTop, writtenSize_long ) != 0 ) goto onErr;
 
-	/* Write SetConfiguration Command */
-	if ( (xmlBufSize = GETSTRINGWITHTAGFROMFILE( p_ppd_name, CNCL_FILE_TAG_CAPABILITY, (int*)CNCL_DECODE_EXEC, &xmlBuf )) < 0 ){
-		DEBUG_PRINT2( "[tocanonij] p_ppd_name : %s\n", p_ppd_name );
-		DEBUG_PRINT2( "[tocanonij] xmlBufSize : %d\n", xmlBufSize );
-		fprintf( stderr, "Error in CNCL_GetStringWithTagFromFile\n" );
-		free(bufTop);
-		return -1;
+	header.size = tplSize - sizeof(CNIJ_HEADER_TEMPLATE);
+	memcpy( tpl, &header, sizeof(header) );
+	if ( header.uuidOffset >= 0 ) {
+		memset( tpl + sizeof(CNIJ_HEADER_TEMPLATE) + header.uuidOffset, '0', header.uuidLength );
+	}
+	if ( header.timeOffset >= 0 ) {
+		memset( tpl + sizeof(CNIJ_HEADER_TEMPLATE) + header.timeOffset, '0', CN_DATETIME_LEN );
 	}
+	memset( blob, 0, sizeof(CNIJ_CAPCACHE_BLOB) );
+	blob->data = tpl;
+	blob->size = tplSize;
+	tpl = NULL;
+	result = tplSize;
+onErr:
+	free( tpl );
+	return result;
+}
 
-	if ( GETSETCONFIGURATIONCOMMAND( Settings, jobID, bufSize, (void *)xmlBuf, xmlBufSize, bufTop, &writtenSize_long ) != 0 ){
-		fprintf( stderr, "Error in CNCL_GetSetConfigurationCommand\n" );
-		free(bufTop);
-		return -1;
+/* PPD identity is checked by the capability cache, the rest goes into the key */
+static void MakeHeaderTemplateKey( CNIJ_HEADER_SOURCE *src, char *key, size_t keySize )
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	long uuidLength = strlen( src->uuid );
+	struct stat libStat;
+
+	hash = HashTemplateKey( hash, src->Settings, sizeof(CNCL_P_SETTINGS) );
+	hash = HashTemplateKey( hash, src->jobID, strlen( src->jobID ) );
+	hash = HashTemplateKey( hash, &src->prot, sizeof(src->prot) );
+	hash = HashTemplateKey( hash, &uuidLength, sizeof(uuidLength) );
+	if ( CnclLibraryStat( &libStat ) == 0 ) {
+		hash = HashTemplateKey( hash, &libStat.st_size, sizeof(libStat.st_size) );
+		hash = HashTemplateKey( hash, &libStat.st_mtim, sizeof(libStat.st_mtim) );
 	}
-	/* WriteData */
-	write( fd, bufTop, writtenSize_long );
-	free(bufTop);
+	snprintf( key, keySize, "%s-%016llx", CN_HEADER_TEMPLATE_KEY, (unsigned long long)hash );
+}
+
+static int CheckHeaderTemplate( const CNIJ_CAPCACHE_BLOB *blob, const char *uuid, CNIJ_HEADER_TEMPLATE *header )
+{
+	if ( blob->size < (int)sizeof(CNIJ_HEADER_TEMPLATE) ) return -1;
+
+	memcpy( header, blob->data, sizeof(CNIJ_HEADER_TEMPLATE) );
+	if ( memcmp( header->magic, CN_HEADER_TEMPLATE_MAGIC, sizeof(header->magic) ) != 0 ) return -1;
+	if ( header->size != blob->size - (long)sizeof(CNIJ_HEADER_TEMPLATE) ) return -1;
+	if ( header->uuidLength != (long)strlen( uuid ) ) return -1;
+	if ( (header->uuidOffset >= 0) && (header->uuidOffset + header->uuidLength > header->size) ) return -1;
+	if ( (header->timeOffset >= 0) && (header->timeOffset + CN_DATETIME_LEN > header->size) ) return -1;
+	if ( (header->uuidOffset >= 0) && (header->timeOffset >= 0) && (header->uuidOffset + header->uuidLength > header->timeOffset) ) return -1;
 	return 0;
-}	
+}
 
-int WriteData(int in_fd, int out_fds[], char jobID[], enum ColorMode *jobColorMode)
+/*
+ * Header commands only differ between jobs in the uuid and the datetime,
+ * so they are generated once per PPD, settings and library, kept next to
+ * the capability cache, and patched on the way out.
+ */
+int WriteHeader(CNIJ_JOB_CONTEXT *ctx, int fd, char jobID[], char uuid[], CNCL_P_SETTINGSPTR Settings, CAPABILITY_DATA capability)
 {
-	long bufSize = sizeof(char) * CN_BUFSIZE;
-	char *bufTop = NULL;
-	long writtenSize_long = 0;
+	DEBUG_PRINT( "[tocanonij] WriteHeader\n");
+	CNIJ_HEADER_SOURCE source;
+	CNIJ_HEADER_TEMPLATE header;
+	CNIJ_CAPCACHE_BLOB blob;
+	char key[64];
+	char dateTime[CN_DATETIME_LEN + 1];
+	const char *cmdTop;
+	struct iovec iov[5];
+	int iovcnt = 0;
+	long pos = 0;
+	int result = -1;
 
-	if ( (bufTop = malloc( bufSize )) == NULL ){
-		return -1;
+	source.ctx = ctx;
+	source.jobID = jobID;
+	source.uuid = uuid;
+	source.Settings = Settings;
+	source.prot = GetProtocol( (char *)capability.deviceID, capability.deviceIDLength );
+	source.exact = 0;
+	MakeHeaderTemplateKey( &source, key, sizeof(key) );
+
+	if ( (CapCacheLookup( ctx->ppdName, key, &blob ) <= 0) || (CheckHeaderTemplate( &blob, uuid, &header ) != 0) ) {
+		CapCacheRelease( &blob );
+		if ( (MakeHeaderTemplate( &source, &blob ) > 0) && (CheckHeaderTemplate( &blob, uuid, &header ) == 0) ) {
+			CapCacheStore( ctx->ppdName, key, blob.data, blob.size );
+		}
+		else {
+			/* fields not found in the commands, generate them for this job only */
+			CapCacheRelease( &blob );
+			source.exact = 1;
+			if ( MakeHeaderTemplate( &source, &blob ) <= 0 ) goto onErr;
+			if ( CheckHeaderTemplate( &blob, uuid, &header ) != 0 ) goto onErr;
+		}
+	}
+	cmdTop = (const char *)blob.data + sizeof(CNIJ_HEADER_TEMPLATE);
+
+	/* OutputSetTime */
+	if ( header.setTimeFirst ) {
+		if ( OutputSetTime( ctx, fd, jobID ) != 0 ) goto onErr;
+	}
+
+	if ( header.uuidOffset >= 0 ) {
+		iov[iovcnt].iov_base = (void *)(cmdTop + pos);
+		iov[iovcnt++].iov_len = header.uuidOffset - pos;
+		iov[iovcnt].iov_base = uuid;
+		iov[iovcnt++].iov_len = header.uuidLength;
+		pos = header.uuidOffset + header.uuidLength;
 	}
+	if ( header.timeOffset >= 0 ) {
+		MakeDateTime( dateTime );
+		iov[iovcnt].iov_base = (void *)(cmdTop + pos);
+		iov[iovcnt++].iov_len = header.timeOffset - pos;
+		iov[iovcnt].iov_base = dateTime;
+		iov[iovcnt++].iov_len = CN_DATETIME_LEN;
+		pos = header.timeOffset + CN_DATETIME_LEN;
+	}
+	iov[iovcnt].iov_base = (void *)(cmdTop + pos);
+	iov[iovcnt++].iov_len = header.size - pos;
+
+	if ( WriteVector( fd, iov, iovcnt ) != 0 ) goto onErr;
 
-	while ( 1 ) {
-		int readBytes = 0;
-		int writeBytes;
-		CNDATA CNData;
-		long readSize = 0;
-		unsigned short next_page;
-		int out_fd = -1;
+	result = 0;
+onErr:
+	CapCacheRelease( &blob );
+	return result;
+}
 
-		memset( &CNData, 0, sizeof(CNDATA) );
 
-		/* read magic number */
-		readBytes = read( in_fd, &CNData, sizeof(CNDATA) );
-		if ( readBytes > 0 ){
-			if ( CNData.magic_num != MAGIC_NUMBER_FOR_CNIJPWG ){
-				fprintf( stderr, "Error illeagal MagicNumber\n" );
-				free(bufTop);
+/*
+ * Relay dataSize bytes of page data from in_fd to out_fd.
+ * The command headers in cmd[] are written first. When both ends allow it
+ * the page body is moved with splice(), otherwise it is copied through
+ * bufTop and the headers go out together with the first data block.
+ */
+static int RelayPageData( int in_fd, int out_fd, int64_t dataSize, struct iovec cmd[], int cmdCount, char *bufTop, long bufSize )
+{
+	static int useSplice = 1;
+	struct iovec iov[3];
+	int iovcnt;
+	ssize_t readBytes;
+	long readSize;
+	int i;
+
+	if ( useSplice ) {
+		/* command headers */
+		if ( WriteVector( out_fd, cmd, cmdCount ) != 0 ) return -1;
+		cmdCount = 0;
+
+		while ( dataSize > 0 ) {
+			readSize = ( dataSize > CN_SPLICE_SIZE ) ? CN_SPLICE_SIZE : dataSize;
+			readBytes = splice( in_fd, NULL, out_fd, NULL, readSize, SPLICE_F_MOVE | SPLICE_F_MORE );
+			DEBUG_PRINT2( "[tocanonij] PASS tocanonij SPLICE<%d>\n", (int)readBytes );
+			if ( readBytes < 0 ) {
+				if ( errno == EINTR ) continue;
+				if ( (errno == EINVAL) || (errno == ENOSYS) ) {
+					/* not a pipe on either side, copy the rest */
+					DEBUG_PRINT( "[tocanonij] splice not supported\n" );
+					useSplice = 0;
+					break;
+				}
+				fprintf( stderr, "DEBUG:[tocanonij] tocnij splice error, %d\n", errno );
 				return -1;
 			}
-			if ( CNData.image_size < 0 ){
+			else if ( readBytes == 0 ) {
 				fprintf( stderr, "Error illeagal dataSize\n" );
-				free(bufTop);
 				return -1;
 			}
+			dataSize -= readBytes;
 		}
-		else if ( readBytes < 0 ){
+	}
+
+	while ( dataSize > 0 ) {
+		readSize = ( dataSize > bufSize ) ? bufSize : dataSize;
+		readBytes = read( in_fd, bufTop, readSize );
+		DEBUG_PRINT2( "[tocanonij] PASS tocanonij READ<%d>\n", (int)readBytes );
+		if ( readBytes < 0 ) {
 			if ( errno == EINTR ) continue;
 			fprintf( stderr, "DEBUG:[tocanonij] tocnij read error, %d\n", errno );
-			free(bufTop);
 			return -1;
 		}
-		else {
-			DEBUG_PRINT( "DEBUG:[tocanonij] !!!DATA END!!!\n" );
-			break; /* data end */
+		else if ( readBytes == 0 ) {
+			fprintf( stderr, "Error illeagal dataSize\n" );
+			return -1;
 		}
+		dataSize -= readBytes;
 
-		if(jobColorMode != NULL) {
-			*jobColorMode = CNData.jobColorMode;
-		}	
+		/* pending command headers go out with this block */
+		iovcnt = 0;
+		for ( i = 0; i < cmdCount; i++ ) {
+			iov[iovcnt++] = cmd[i];
+		}
+		cmdCount = 0;
+		iov[iovcnt].iov_base = bufTop;
+		iov[iovcnt].iov_len = readBytes;
+		iovcnt++;
 
+		if ( WriteVector( out_fd, iov, iovcnt ) != 0 ) return -1;
+	}
 
-		if(CNData.pageColorMode == COLOR_MODE_COLOR) {
-			out_fd = out_fds[0];
-		} else if(CNData.pageColorMode == COLOR_MODE_GRAY) {
-			out_fd = out_fds[1];
+	/* empty page */
+	if ( cmdCount > 0 ) {
+		if ( WriteVector( out_fd, cmd, cmdCount ) != 0 ) return -1;
+	}
+
+	return 0;
+}
+
+/* drop dataSize bytes of page data that no output wants */
+static int SkipPageData( int in_fd, int64_t dataSize, char *bufTop, long bufSize )
+{
+	ssize_t readBytes;
+
+	while ( dataSize > 0 ) {
+		readBytes = read( in_fd, bufTop, ( dataSize > bufSize ) ? bufSize : dataSize );
+		if ( readBytes < 0 ) {
+			if ( errno == EINTR ) continue;
+			fprintf( stderr, "DEBUG:[tocanonij] tocnij read error, %d\n", errno );
+			return -1;
+		}
+		else if ( readBytes == 0 ) {
+			fprintf( stderr, "Error illeagal dataSize\n" );
+			return -1;
 		}
+		dataSize -= readBytes;
+	}
+
+	return 0;
+}
+
+/* read size bytes, returns the bytes read which are short of size only at the data end */
+static long ReadFull( int in_fd, void *buf, long size )
+{
+	long total = 0;
+	ssize_t readBytes;
 
+	while ( total < size ) {
+		readBytes = read( in_fd, (char *)buf + total, size - total );
+		if ( readBytes < 0 ) {
+			if ( errno == EINTR ) continue;
+			fprintf( stderr, "DEBUG:[tocanonij] tocnij read error, %d\n", errno );
+			return -1;
+		}
+		else if ( readBytes == 0 ) {
+			break;
+		}
+		total += readBytes;
+	}
+	return total;
+}
+
+/* CNDATA from an older tocnpwg as CNDATA2 */
+static void ConvertRecordV1( const CNDATA *v1, CNDATA2 *CNData )
+{
+	memset( CNData, 0, sizeof(CNDATA2) );
+	CNData->magic_num = MAGIC_NUMBER_FOR_CNIJPWG2;
+	CNData->record_size = sizeof(CNDATA2);
+	CNData->image_size = v1->image_size;
+	CNData->page_seq = (unsigned short)v1->page_num;
+	CNData->jobColorMode = v1->jobColorMode;
+	CNData->pageColorMode = v1->pageColorMode;
+	if ( !v1->next_page ) {
+		CNData->flags |= CNDATA2_FLAG_LAST_PAGE;
+	}
+	if ( v1->chunk_flags & CNDATA_CHUNK_MORE ) {
+		CNData->flags |= CNDATA2_FLAG_CHUNK_MORE;
+	}
+}
+
+/*
+ * Read one page record, returns 1 for a record and 0 at the data end.
+ * The magic number in the first 32 bits tells the record version,
+ * both versions come back as CNDATA2.
+ */
+static int ReadRecord( CNIJ_JOB_CONTEXT *ctx, int in_fd, CNDATA2 *CNData )
+{
+	union {
+		uint32_t	magic_num;
+		CNDATA		v1;
+		CNDATA2		v2;
+	} rec;
+	long readBytes;
+
+	memset( &rec, 0, sizeof(rec) );
+
+	/* read magic number */
+	if ( (readBytes = ReadFull( in_fd, &rec.magic_num, sizeof(uint32_t) )) <= 0 ) {
+		if ( readBytes == 0 ) {
+			DEBUG_PRINT( "DEBUG:[tocanonij] !!!DATA END!!!\n" );
+		}
+		return readBytes;
+	}
+	if ( readBytes != sizeof(uint32_t) ) goto onTruncated;
+
+	if ( rec.magic_num == MAGIC_NUMBER_FOR_CNIJPWG2 ) {
+		readBytes = sizeof(CNDATA2) - sizeof(uint32_t);
+		if ( ReadFull( in_fd, (char *)&rec.v2 + sizeof(uint32_t), readBytes ) != readBytes ) goto onTruncated;
+		if ( rec.v2.record_size < sizeof(CNDATA2) ) {
+			fprintf( stderr, "Error illeagal record size\n" );
+			return -1;
+		}
+		/* fields of a later version */
+		if ( SkipPageData( in_fd, rec.v2.record_size - sizeof(CNDATA2), ctx->dataBuf, ctx->dataBufSize ) != 0 ) return -1;
+		if ( rec.v2.image_size > INT64_MAX ) {
+			fprintf( stderr, "Error illeagal dataSize\n" );
+			return -1;
+		}
+
+		memcpy( CNData, &rec.v2, sizeof(CNDATA2) );
+		CNData->record_size = sizeof(CNDATA2);
+	}
+	else if ( rec.magic_num == MAGIC_NUMBER_FOR_CNIJPWG ) {
+		readBytes = sizeof(CNDATA) - sizeof(uint32_t);
+		if ( ReadFull( in_fd, (char *)&rec.v1 + sizeof(uint32_t), readBytes ) != readBytes ) goto onTruncated;
+		if ( rec.v1.image_size < 0 ) {
+			fprintf( stderr, "Error illeagal dataSize\n" );
+			return -1;
+		}
+
+		ConvertRecordV1( &rec.v1, CNData );
+	}
+	else {
+		fprintf( stderr, "Error illeagal MagicNumber\n" );
+		return -1;
+	}
+	return 1;
+
+onTruncated:
+	fprintf( stderr, "Error illeagal record\n" );
+	return -1;
+}
+
+/*
+ * SetPageConfiguration and SendData commands for one page.
+ * A chunk that continues the page only gets its own SendData command.
+ */
+static int MakePageCommand( CNIJ_JOB_CONTEXT *ctx, char jobID[], const CNDATA2 *CNData, int64_t dataSize, short continued, struct iovec cmd[] )
+{
+	long bufSize = ctx->cmdBufSize;
+	char *bufTop = ctx->cmdBuf;
+	long pageCmdSize = 0;
+	long sendCmdSize = 0;
+	unsigned short next_page;
+
+	/* SendData takes a long, split larger pages with --bandlines */
+	if ( dataSize > LONG_MAX ) {
+		fprintf( stderr, "Error page %u is too large for SendData\n", CNData->page_seq );
+		return -1;
+	}
+
+	if ( !continued ) {
 		/* Write Next Page Info */
-		if ( CNData.next_page ) {
+		if ( !(CNData->flags & CNDATA2_FLAG_LAST_PAGE) ) {
 			next_page = CNCL_PSET_NEXTPAGE_ON;
 		}
 		else {
 			next_page = CNCL_PSET_NEXTPAGE_OFF; 
 		}
-		if ( GETSETPAGECONFIGUARTIONCOMMAND( jobID, next_page, bufTop, bufSize, &writtenSize_long ) != 0 ) {
+		if ( GETSETPAGECONFIGUARTIONCOMMAND( jobID, next_page, bufTop, bufSize, &pageCmdSize ) != 0 ) {
 			fprintf( stderr, "Error in CNCL_GetPrintCommand\n" );
-			free(bufTop);
 			return -1;
 		}
-		
-		/* WriteData */
-		if ( write( out_fd, bufTop, writtenSize_long) != writtenSize_long ){
-			free(bufTop);
-			return -1;
-		} 
-
-		DEBUG_PRINT( "[tocanonij] Write SendData Command\n");
-		/* Write SendData Command */
-		memset(	bufTop, 0x00, bufSize );
-		readSize = CNData.image_size;
-		if ( GETSENDDATAPWGRASTERCOMMAND( jobID, readSize, bufSize, bufTop, &writtenSize_long ) != 0 ) {
-			DEBUG_PRINT( "Error in CNCL_GetSendDataJPEGCommand\n" );
-			free(bufTop);
-			return -1;
+	}
+
+	DEBUG_PRINT( "[tocanonij] Write SendData Command\n");
+	/* SendData Command follows SetPageConfiguration in the same buffer */
+	memset(	bufTop + pageCmdSize, 0x00, bufSize - pageCmdSize );
+	if ( GETSENDDATAPWGRASTERCOMMAND( jobID, dataSize, bufSize - pageCmdSize, bufTop + pageCmdSize, &sendCmdSize ) != 0 ) {
+		DEBUG_PRINT( "Error in CNCL_GetSendDataJPEGCommand\n" );
+		return -1;
+	}
+
+	cmd[0].iov_base = bufTop;
+	cmd[0].iov_len = pageCmdSize;
+	cmd[1].iov_base = bufTop + pageCmdSize;
+	cmd[1].iov_len = sendCmdSize;
+	return 0;
+}
+
+/*
+ * Send the chunks kept in spool_fd with next_page of the page's last record,
+ * SetPageConfiguration goes before the first of them. Returns the number of
+ * chunks sent, -1 on error.
+ */
+static int FlushPageChunks( CNIJ_JOB_CONTEXT *ctx, int spool_fd, int out_fd, char jobID[], const CNDATA2 *last )
+{
+	CNDATA2 CNData;
+	struct iovec cmd[2];
+	int count = 0;
+	int ret;
+
+	if ( lseek( spool_fd, 0, SEEK_SET ) != 0 ) return -1;
+	while ( (ret = ReadRecord( ctx, spool_fd, &CNData )) > 0 ) {
+		CNData.flags = (CNData.flags & ~CNDATA2_FLAG_LAST_PAGE) | (last->flags & CNDATA2_FLAG_LAST_PAGE);
+		if ( MakePageCommand( ctx, jobID, &CNData, CNData.image_size, (count > 0), cmd ) != 0 ) return -1;
+		if ( RelayPageData( spool_fd, out_fd, CNData.image_size, cmd, 2, ctx->dataBuf, ctx->dataBufSize ) != 0 ) return -1;
+		count++;
+	}
+	if ( ret < 0 ) return -1;
+
+	if ( (ftruncate( spool_fd, 0 ) != 0) || (lseek( spool_fd, 0, SEEK_SET ) != 0) ) return -1;
+	return count;
+}
+
+/*
+ * Relay every page record from in_fd.
+ * Color pages go to out_fds[0] and gray pages to out_fds[1], -1 drops them.
+ * next_page is only known from the last record of a page, so the chunks
+ * before it are kept in a temporary file until it arrives.
+ */
+int WriteData(CNIJ_JOB_CONTEXT *ctx, int in_fd, int out_fds[], char jobID[])
+{
+	CNDATA2 CNData;
+	struct iovec cmd[2];
+	struct iovec rec;
+	int out_fd;
+	int spool_fd = -1;
+	int spooled = 0;		/* chunks of the current page in spool_fd */
+	int sent;
+	int ret;
+	int result = -1;
+
+	while ( (ret = ReadRecord( ctx, in_fd, &CNData )) > 0 ) {
+		out_fd = -1;
+		if(CNData.pageColorMode == COLOR_MODE_COLOR) {
+			out_fd = out_fds[0];
+		} else if(CNData.pageColorMode == COLOR_MODE_GRAY) {
+			out_fd = out_fds[1];
 		}
-		/* WriteData */
-		write( out_fd, bufTop, writtenSize_long );
 
-		while( readSize ){
-			char *pCurrent = bufTop;
+		if ( out_fd == -1 ) {
+			/* the other color stream is being printed */
+			DEBUG_PRINT2( "[tocanonij] skip page %u\n", CNData.page_seq );
+			if ( SkipPageData( in_fd, CNData.image_size, ctx->dataBuf, ctx->dataBufSize ) != 0 ) goto onErr;
+			continue;
+		}
 
-			if ( readSize - bufSize > 0 ){
-				readBytes = read( in_fd, bufTop, bufSize );
-				DEBUG_PRINT2( "[tocanonij] PASS tocanonij READ1<%d>\n", readBytes );
-				if ( readBytes < 0 ) {
-					if ( errno == EINTR ) continue;
-				}
-				readSize -= readBytes;
-			}
-			else {
-				readBytes = read( in_fd, bufTop, readSize );
-				DEBUG_PRINT2( "[tocanonij] PASS tocanonij READ2<%d>\n", readBytes );
-				if ( readBytes < 0 ) {
-					if ( errno == EINTR ) continue;
-				}
-				readSize -= readBytes;
-			}
+		if ( CNData.flags & CNDATA2_FLAG_CHUNK_MORE ) {
+			if ( (spool_fd == -1) && ((spool_fd = CreateCacheFile()) == -1) ) goto onErr;
+			rec.iov_base = &CNData;
+			rec.iov_len = sizeof(CNDATA2);
+			if ( RelayPageData( in_fd, spool_fd, CNData.image_size, &rec, 1, ctx->dataBuf, ctx->dataBufSize ) != 0 ) goto onErr;
+			spooled++;
+			continue;
+		}
 
-			do {
-				writeBytes = write( out_fd, pCurrent, readBytes );
-				DEBUG_PRINT2( "[tocanonij] PASS tocanonij WRITE<%d>\n", writeBytes );
-				if( writeBytes < 0){
-					if ( errno == EINTR ) continue;
-					free(bufTop);
-					return -1;
-				}
-				readBytes -= writeBytes;
-				pCurrent += writeBytes;
-			} while( writeBytes > 0 );
+		sent = 0;
+		if ( spooled > 0 ) {
+			if ( (sent = FlushPageChunks( ctx, spool_fd, out_fd, jobID, &CNData )) < 0 ) goto onErr;
+			spooled = 0;
 		}
-	}
 
-	free(bufTop);
+		/* a band that ended exactly at the page end leaves an empty last chunk */
+		if ( (sent > 0) && (CNData.image_size == 0) ) continue;
 
-	return 0;
+		if ( MakePageCommand( ctx, jobID, &CNData, CNData.image_size, (sent > 0), cmd ) != 0 ) goto onErr;
+
+		/* WriteData */
+		if ( RelayPageData( in_fd, out_fd, CNData.image_size, cmd, 2, ctx->dataBuf, ctx->dataBufSize ) != 0 ) goto onErr;
+	}
+	if ( ret < 0 ) goto onErr;
+	if ( spooled > 0 ) {
+		fprintf( stderr, "Error page data ends in a chunk\n" );
+		goto onErr;
+	}
+
+	result = 0;
+onErr:
+	if ( spool_fd != -1 ) {
+		close( spool_fd );
+	}
+	return result;
 }
 
-int WritePages(int in_fd, int out_fd, char jobID[])
+int WritePages(CNIJ_JOB_CONTEXT *ctx, int in_fd, int out_fd, char jobID[])
 {
 	DEBUG_PRINT( "[tocanonij] WritePages\n" );
 	int out_fds[2] = { out_fd, out_fd };
-	return WriteData(in_fd, out_fds, jobID, NULL);
+	return WriteData(ctx, in_fd, out_fds, jobID);
 }
 
-int WriteCacheFile(int in_fd, int out_fds[], char jobID[], enum ColorMode *jobColorMode)
+/*
+ * Keep the color page records as they are until the job turns out to be
+ * color, then return WRITEDATA_COLOR_JOB. Gray copies sent by an older
+ * tocnpwg are dropped, ReplayCacheFile makes them from the color pages.
+ */
+int WriteCacheFile(CNIJ_JOB_CONTEXT *ctx, int in_fd, int out_fd, enum ColorMode *jobColorMode)
 {
 	DEBUG_PRINT( "[tocanonij] WriteCacheFile\n" );
-	return WriteData(in_fd, out_fds, jobID, jobColorMode);
+	CNDATA2 CNData;
+	struct iovec rec;
+	int ret;
+
+	while ( (ret = ReadRecord( ctx, in_fd, &CNData )) > 0 ) {
+		*jobColorMode = CNData.jobColorMode;
+
+		if ( CNData.pageColorMode != COLOR_MODE_COLOR ) {
+			if ( SkipPageData( in_fd, CNData.image_size, ctx->dataBuf, ctx->dataBufSize ) != 0 ) return -1;
+		}
+		else {
+			rec.iov_base = &CNData;
+			rec.iov_len = sizeof(CNDATA2);
+			if ( RelayPageData( in_fd, out_fd, CNData.image_size, &rec, 1, ctx->dataBuf, ctx->dataBufSize ) != 0 ) return -1;
+		}
+
+		if ( *jobColorMode == COLOR_MODE_COLOR ) {
+			/* the verdict never goes back to gray */
+			return WRITEDATA_COLOR_JOB;
+		}
+	}
+
+	return ret;
 }
 
-int WriteTail(int out_fd, char jobID[])
+int WriteTail(CNIJ_JOB_CONTEXT *ctx, int out_fd, char jobID[])
 {
 	DEBUG_PRINT( "[tocanonij] WriteTail\n");
-	long bufSize = sizeof(char) * CN_BUFSIZE;
-	char *bufTop = NULL;
-	int retSize = 0;
 	long writtenSize_long = 0;
 
-	if ( (bufTop = malloc( bufSize )) == NULL ){
-		DEBUG_PRINT( "Error in malloc\n" );
-		return -1;
-	}
-
 	/* CNCL_GetPrintCommand */
-	if ( GETPRINTCOMMAND( bufTop, bufSize, &writtenSize_long, jobID, CNCL_COMMAND_END ) != 0 ) {
+	if ( GETPRINTCOMMAND( ctx->cmdBuf, ctx->cmdBufSize, &writtenSize_long, jobID, CNCL_COMMAND_END ) != 0 ) {
 		DEBUG_PRINT( "Error in CNCL_GetPrintCommand\n" );
-		free(bufTop);
 		return -1;
 	}
 	/* WriteData */
-	retSize = write( out_fd, bufTop, writtenSize_long );
-	if(retSize == 0){
+	if ( write( out_fd, ctx->cmdBuf, writtenSize_long ) != writtenSize_long ){
 		DEBUG_PRINT( "Error in WriteData\n" );
-		free(bufTop);
 		return -1;
 	}
 	DEBUG_PRINT( "[tocanonij] to_cnijf <end>\n" );
 
-	free(bufTop);
 	return 0;
 }
 
-void CreateCacheFile(int out_fds[])
+int CreateCacheFile(void)
 {
 	DEBUG_PRINT( "[tocanonij] CreateCacheFile\n" );
-	for(int i = 0; i < COLOR_MODE_COUNT; i++){
-		char tmpName[64];
-		strncpy( tmpName, CNIJ_TEMP, 64 );
-		out_fds[i] = mkstemp( tmpName );
-		if(out_fds[i] != -1){
-			unlink( tmpName );
-		}
+	char tmpName[64];
+	int fd;
+
+	strncpy( tmpName, CNIJ_TEMP, 64 );
+	fd = mkstemp( tmpName );
+	if(fd != -1){
+		unlink( tmpName );
 	}
+	return fd;
 }
 
-int ReplayCacheFile(int in_fd, int out_fd)
+/* write the cached color pages converted to gray */
+static int ReplayGrayCacheFile(CNIJ_JOB_CONTEXT *ctx, int in_fd, int out_fd, char jobID[])
 {
-	DEBUG_PRINT( "[tocanonij] ReplayCacheFile\n");
-	long bufSize = sizeof(char) * CN_BUFSIZE;
-	char *bufTop = NULL;
+	struct stat st;
+	unsigned char *mapTop = MAP_FAILED;
+	off_t offset = 0;
+	long graySize;
+	CNDATA2 CNData;
+	struct iovec cmd[2];
+	int result = -1;
 
-	if ( (bufTop = malloc( bufSize )) == NULL ){
-		DEBUG_PRINT( "Error in malloc\n" );
-		return -1;
+	if ( fstat( in_fd, &st ) != 0 ) goto onErr;
+	if ( st.st_size == 0 ) {
+		result = 0;
+		goto onErr;
 	}
 
-	lseek(in_fd, 0, SEEK_SET);
-	while(1){
-		int readBytes = read( in_fd, bufTop, bufSize );
-		if(readBytes <= 0){
-			break;
+	mapTop = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, in_fd, 0 );
+	if ( mapTop == MAP_FAILED ) goto onErr;
+
+	while ( offset + (off_t)sizeof(CNDATA2) <= st.st_size ) {
+		memcpy( &CNData, mapTop + offset, sizeof(CNDATA2) );
+		offset += sizeof(CNDATA2);
+		if ( CNData.image_size > (uint64_t)(st.st_size - offset) ) goto onErr;
+
+		/* size first, the SendData command carries it */
+		if ( (graySize = PwgGrayTranscode( mapTop + offset, CNData.image_size, -1, NULL, 0 )) < 0 ) {
+			fprintf( stderr, "Error in PwgGrayTranscode\n" );
+			goto onErr;
 		}
+		if ( MakePageCommand( ctx, jobID, &CNData, graySize, 0, cmd ) != 0 ) goto onErr;
+		if ( WriteVector( out_fd, cmd, 2 ) != 0 ) goto onErr;
 
-		if(write(out_fd, bufTop, readBytes) == 0){
-			DEBUG_PRINT( "Error in WriteData\n" );
-			free( bufTop );
-			return -1;
-		}	
+		if ( PwgGrayTranscode( mapTop + offset, CNData.image_size, out_fd, (unsigned char *)ctx->dataBuf, ctx->dataBufSize ) != graySize ) {
+			fprintf( stderr, "Error in PwgGrayTranscode\n" );
+			goto onErr;
+		}
+		offset += CNData.image_size;
 	}
-	
-	free( bufTop );
 
-	DEBUG_PRINT( "ReplayCacheFile return 0\n" );
-	return 0;
+	result = 0;
+onErr:
+	if ( mapTop != MAP_FAILED ) {
+		munmap( mapTop, st.st_size );
+	}
+	return result;
+}
+
+int ReplayCacheFile(CNIJ_JOB_CONTEXT *ctx, int in_fd, int out_fd, char jobID[], enum ColorMode jobColorMode)
+{
+	DEBUG_PRINT( "[tocanonij] ReplayCacheFile\n");
+	int out_fds[2] = { out_fd, -1 };
+
+	if ( jobColorMode == COLOR_MODE_GRAY ) {
+		return ReplayGrayCacheFile( ctx, in_fd, out_fd, jobID );
+	}
+
+	lseek(in_fd, 0, SEEK_SET);
+	return WriteData( ctx, in_fd, out_fds, jobID );
 }
 
 int GetJobId(char jobID[], CAPABILITY_DATA capability)
@@ -638,7 +1158,6 @@ int main( int argc, char *argv[] )
 	CNCL_P_SETTINGS Settings;
 	char jobID[CN_START_JOBID_LEN];
 	char libPathBuf[CN_LIB_PATH_LEN];
-	void *libclss = NULL;
 	struct option long_opt[] = {
 		{ "version", required_argument, NULL, OPT_VERSION }, 
 		{ "filterpath", required_argument, NULL, OPT_FILTERPATH }, 
@@ -650,6 +1169,7 @@ int main( int argc, char *argv[] )
 		{ "uuid", required_argument, NULL, OPT_UUID }, 
 		{ "rotate180", required_argument, NULL, OPT_ROTATE180 },
 		{ "optimization", required_argument, NULL, OPT_OPTIMIZATION},
+		{ "bandlines", required_argument, NULL, OPT_BANDLINES },
 		{ 0, 0, 0, 0 }, 
 	};
 	const char *p_ppd_name = getenv("PPD");
@@ -659,22 +1179,13 @@ int main( int argc, char *argv[] )
 	short optimization = 0;
 	enum ColorMode jobColorMode = COLOR_MODE_GRAY;
 	int cnijtmp_fd = -1;
-	int cnijtmp_fds[2] = { -1, -1 };
+	int live_fds[2] = { 1, -1 };
+	int ret;
+	CNIJ_JOB_CONTEXT jobContext;
 
 	DEBUG_PRINT( "[tocanonij] start tocanonij\n" );
+	memset( &jobContext, 0, sizeof(CNIJ_JOB_CONTEXT) );
 
-	/* init CNCL API */
-	GETSETCONFIGURATIONCOMMAND = NULL;
-	GETSENDDATAPWGRASTERCOMMAND = NULL;
-	GETPRINTCOMMAND = NULL;
-	GETSTRINGWITHTAGFROMFILE = NULL;
-	GETSETPAGECONFIGUARTIONCOMMAND = NULL;
-	MAKEBJLSETTIMEJOB = NULL;
-	GetProtocol = NULL;
-	ParseCapabilityResponsePrint_HostEnv=NULL;
-	MakeCommand_StartJob3 = NULL;
-	ParseCapabilityResponsePrint_DateTime = NULL;
-	MakeCommand_SetJobConfiguration = NULL;
 
 	/* Init Settings */
 	memset( &Settings, 0x00, sizeof(CNCL_P_SETTINGS) );
@@ -692,7 +1203,7 @@ int main( int argc, char *argv[] )
 				break;
 			case OPT_PAPERSIZE:
 				DEBUG_PRINT3( "[tocanonij] OPTION(%s):VALUE(%s)\n", long_opt[opt_index].name, optarg );
-				Settings.papersize = ConvertStrToID( optarg, papersizeTbl );
+				Settings.papersize = ConvertStrToID( optarg, &papersizeHash );
 				if ( IsBorderless( optarg ) ){
 					Settings.borderlessprint = CNCL_PSET_BORDERLESS_ON;
 				}
@@ -702,7 +1213,7 @@ int main( int argc, char *argv[] )
 				break;
 			case OPT_MEDIATYPE:
 				DEBUG_PRINT3( "[tocanonij] OPTION(%s):VALUE(%s)\n", long_opt[opt_index].name, optarg );
-				Settings.mediatype = ConvertStrToID( optarg, mediatypeTbl );
+				Settings.mediatype = ConvertStrToID( optarg, &mediatypeHash );
 				DEBUG_PRINT2( "[tocanonij] media : %d\n", Settings.mediatype );
 				break;
 #if 0
@@ -718,12 +1229,12 @@ int main( int argc, char *argv[] )
 #endif
 			case OPT_COLORMODE:
 				DEBUG_PRINT3( "[tocanonij] OPTION(%s):VALUE(%s)\n", long_opt[opt_index].name, optarg );
-				Settings.colormode = ConvertStrToID( optarg, colormodeTbl );
+				Settings.colormode = ConvertStrToID( optarg, &colormodeHash );
 				break;
 			case OPT_DUPLEXPRINT:
 				DEBUG_PRINT3( "[tocanonij] OPTION(%s):VALUE(%s)\n", long_opt[opt_index].name, optarg );
 				//Settings.duplexprint = CNCL_PSET_DUPLEX_OFF;
-				Settings.duplexprint = ConvertStrToID( optarg, duplexprintTbl);
+				Settings.duplexprint = ConvertStrToID( optarg, &duplexprintHash );
 				break;
 
 			case OPT_UUID:
@@ -742,6 +1253,8 @@ int main( int argc, char *argv[] )
 					optimization = 1;
 				}
 				break;
+			case OPT_BANDLINES:  /* ignore this option, the records tell where a page goes on */
+				break;
 			case '?':
 				fprintf( stderr, "Error: invalid option %c:\n", optopt);
 				break;
@@ -750,7 +1263,7 @@ int main( int argc, char *argv[] )
 		}
 	}
 
-	/* dlopen */
+	/* load CNCL */
 	/* Make progamname with path of execute progname. */
 	//snprintf( libPathBuf, CN_LIB_PATH_LEN, "%s%s", GetExecProgPath(), CN_CNCL_LIBNAME );
 	DEBUG_PRINT2( "[tocanonij] libPath : %s\n", libPathBuf );
@@ -760,67 +1273,8 @@ int main( int argc, char *argv[] )
 	DEBUG_PRINT2( "[tocanonij] libPath : %s\n", libPathBuf );
 
 
-	libclss = dlopen( libPathBuf, RTLD_LAZY );
-	if ( !libclss ) {
-		fprintf( stderr, "Error in dlopen\n" );
-		goto onErr;
-	}
-
-	GETSETCONFIGURATIONCOMMAND = dlsym( libclss, "CNCL_GetSetConfigurationCommand" );
-	if ( dlerror() != NULL ) {
-		fprintf( stderr, "Error in CNCL_GetSetConfigurationCommand. API not Found.\n" );
-		goto onErr;
-	}
-	GETSENDDATAPWGRASTERCOMMAND = dlsym( libclss, "CNCL_GetSendDataPWGRasterCommand" );
-	if ( dlerror() != NULL ) {
-		fprintf( stderr, "Error in CNCL_GetSendDataPWGRasterCommand\n" );
-		goto onErr;
-	}
-	GETPRINTCOMMAND = dlsym( libclss, "CNCL_GetPrintCommand" );
-	if ( dlerror() != NULL ) {
-		fprintf( stderr, "Error in CNCL_GetPrintCommand\n" );
-		goto onErr;
-	}
-	GETSTRINGWITHTAGFROMFILE = dlsym( libclss, "CNCL_GetStringWithTagFromFile" );
-	if ( dlerror() != NULL ) {
-		fprintf( stderr, "Error in CNCL_GetStringWithTagFromFile\n" );
-		goto onErr;
-	}
-	GETSETPAGECONFIGUARTIONCOMMAND = dlsym( libclss, "CNCL_GetSetPageConfigurationCommand" );
-	if ( dlerror() != NULL ) {
-		fprintf( stderr, "Load Error in CNCL_GetSetPageConfigurationCommand\n" );
-		goto onErr;
-	}
-	MAKEBJLSETTIMEJOB = dlsym( libclss, "CNCL_MakeBJLSetTimeJob" );
-	if ( dlerror() != NULL ) {
-		fprintf( stderr, "Load Error in CNCL_MakeBJLSetTimeJob\n" );
-		goto onErr;
-	}
-	GetProtocol = dlsym( libclss, "CNCL_GetProtocol" );
-	if ( dlerror() != NULL ) {
-		fprintf( stderr, "Load Error in CNCL_MakeBJLSetTimeJob\n" );
-		goto onErr;
-	}
-	ParseCapabilityResponsePrint_HostEnv = dlsym( libclss, "CNCL_ParseCapabilityResponsePrint_HostEnv" );
-	if ( dlerror() != NULL ) {
-		fprintf( stderr, "Load Error in CNCL_ParseCapabilityResponsePrint_HostEnv\n" );
-		goto onErr;
-	}
-	MakeCommand_StartJob3 = dlsym( libclss, "CNCL_MakeCommand_StartJob3" );
-	if ( dlerror() != NULL ) {
-		fprintf( stderr, "Load Error in CNCL_MakeCommand_StartJob3\n" );
-		goto onErr;
-	}
-	ParseCapabilityResponsePrint_DateTime = dlsym( libclss, "CNCL_ParseCapabilityResponsePrint_DateTime" );
-	if ( dlerror() != NULL ) {
-		fprintf( stderr, "Load Error in CNCL_ParseCapabilityResponsePrint_DateTime\n" );
-		goto onErr;
-	}
-	MakeCommand_SetJobConfiguration = dlsym( libclss, "CNCL_MakeCommand_SetJobConfiguration" );
-	if ( dlerror() != NULL ) {
-		fprintf( stderr, "Load Error in CNCL_MakeCommand_SetJobConfiguration\n" );
-		goto onErr;
-	}
+	if ( CnclOpen( libPathBuf ) != 0 ) goto onErr;
+	if ( CnclRequire( cnclRequired, sizeof(cnclRequired) / sizeof(cnclRequired[0]) ) != 0 ) goto onErr;
 
 	/* Check Settings */
 	if ( CheckSettings( &Settings ) != 0 ) goto onErr;
@@ -840,57 +1294,66 @@ int main( int argc, char *argv[] )
 		goto onErr;
 	}
 
+	/* Allocate job buffers */
+	if(InitJobContext(&jobContext, p_ppd_name) != 0){
+		goto onErr;
+	}
+
 	if((Settings.colormode == CNCL_PSET_COLORMODE_COLOR) && 
 	   (optimization == 1 )){
 		/* Create cache file */
-		CreateCacheFile(cnijtmp_fds);
-		if(cnijtmp_fds[0] == -1 || cnijtmp_fds[1] == -1){
+		if((cnijtmp_fd = CreateCacheFile()) == -1){
 			goto onErr;
 		}
 
-		/* Write data to cache file */
-		if(WriteCacheFile(fd, cnijtmp_fds, jobID, &jobColorMode) != 0){
+		/* Write data to cache file until the job turns out to be color */
+		if((ret = WriteCacheFile(&jobContext, fd, cnijtmp_fd, &jobColorMode)) < 0){
 			goto onErr;
 		}
 
-		if(jobColorMode == COLOR_MODE_COLOR){
-			cnijtmp_fd = cnijtmp_fds[0];
-		} else if (jobColorMode == COLOR_MODE_GRAY){
+		if (jobColorMode == COLOR_MODE_GRAY){
 			Settings.colormode = CNCL_PSET_COLORMODE_MONO;
-			cnijtmp_fd = cnijtmp_fds[1];
-		} else{
+		} else if (jobColorMode != COLOR_MODE_COLOR){
 			goto onErr;
 		}
 		DEBUG_PRINT2( "[tocanonij] jobColorMode:%d\n", jobColorMode);
 
 		/* Write header data to out port*/
-		if(WriteHeader(1, jobID, uuid, &Settings, capability) != 0){
+		if(WriteHeader(&jobContext, 1, jobID, uuid, &Settings, capability) != 0){
 			goto onErr;
 		}
 
 		/* Get data from cache file and write it to out port */
-		if(ReplayCacheFile(cnijtmp_fd, 1) != 0){
+		if(ReplayCacheFile(&jobContext, cnijtmp_fd, 1, jobID, jobColorMode) != 0){
 			goto onErr;
 		}
 
+		if(ret == WRITEDATA_COLOR_JOB){
+			/* Stream the remaining color pages */
+			DEBUG_PRINT( "[tocanonij] stream remaining pages\n" );
+			if(WriteData(&jobContext, fd, live_fds, jobID) != 0){
+				goto onErr;
+			}
+		}
+
 		/*Write tail data to out port */
-		if(WriteTail(1, jobID) != 0){
+		if(WriteTail(&jobContext, 1, jobID) != 0){
 			goto onErr;
 		}
 		
 	} else {
 		/* Write header data */
-		if(WriteHeader(1, jobID, uuid, &Settings, capability) != 0){
+		if(WriteHeader(&jobContext, 1, jobID, uuid, &Settings, capability) != 0){
 			goto onErr;
 		}
 
 		/* Write page Data */
-		if(WritePages(fd, 1, jobID) != 0){
+		if(WritePages(&jobContext, fd, 1, jobID) != 0){
 			goto onErr;
 		}
 		
 		/* Write tail data */
-		if(WriteTail(1, jobID) != 0){
+		if(WriteTail(&jobContext, 1, jobID) != 0){
 			goto onErr;
 		}
 	}
@@ -898,16 +1361,10 @@ int main( int argc, char *argv[] )
 	result = 0;
 
 onErr:
-	if ( libclss != NULL ) {
-		dlclose( libclss );
-	}
-
-	if(cnijtmp_fds[0] != -1){
-		close(cnijtmp_fds[0]);
-	}
+	FreeJobContext( &jobContext );
 
-	if(cnijtmp_fds[1] != -1){
-		close(cnijtmp_fds[1]);
+	if(cnijtmp_fd != -1){
+		close(cnijtmp_fd);
 	}
 
 	return result;
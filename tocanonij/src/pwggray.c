@@ -0,0 +1,286 @@
+/*
+ *  Canon Inkjet Printer Driver for Linux
+ *  Copyright CANON INC. 2001-2024
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * NOTE:
+ *  - As a special exception, this program is permissible to link with the
+ *    libraries released as the binary modules.
+ *  - If you write modifications of your own for these programs, it is your
+ *    choice whether to permit this exception to apply to your modifications.
+ *    If you do not wish that, delete this exception.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <arpa/inet.h>
+
+#include "com_def.h"
+#include "pwggray.h"
+
+#define PWG_LINE_REPEAT_MAX		(256)
+#define PWG_RUN_MAX				(128)
+#define RGB_COMPONENT			(3)
+
+/* buffered output, counts only when fd is -1 */
+typedef struct {
+	int				fd;
+	unsigned char	*buf;
+	long			bufSize;
+	long			pos;
+	long			total;
+} PWGGRAY_SINK;
+
+static uint32_t GetHeaderValue( const unsigned char *header, int offset )
+{
+	uint32_t value;
+
+	memcpy( &value, header + offset, sizeof(value) );
+	return ntohl( value );
+}
+
+static void SetHeaderValue( unsigned char *header, int offset, uint32_t value )
+{
+	value = htonl( value );
+	memcpy( header + offset, &value, sizeof(value) );
+}
+
+static int SinkFlush( PWGGRAY_SINK *sink )
+{
+	unsigned char *pCurrent = sink->buf;
+	ssize_t writeBytes;
+
+	while ( sink->pos > 0 ) {
+		writeBytes = write( sink->fd, pCurrent, sink->pos );
+		if ( writeBytes < 0 ) {
+			if ( errno == EINTR ) continue;
+			return -1;
+		}
+		sink->pos -= writeBytes;
+		pCurrent += writeBytes;
+	}
+
+	return 0;
+}
+
+static int SinkWrite( PWGGRAY_SINK *sink, const unsigned char *data, long size )
+{
+	long copySize;
+
+	sink->total += size;
+	if ( sink->fd == -1 ) return 0;
+
+	while ( size > 0 ) {
+		if ( sink->pos == sink->bufSize ) {
+			if ( SinkFlush( sink ) != 0 ) return -1;
+		}
+		copySize = sink->bufSize - sink->pos;
+		if ( copySize > size ) copySize = size;
+
+		memcpy( sink->buf + sink->pos, data, copySize );
+		sink->pos += copySize;
+		data += copySize;
+		size -= copySize;
+	}
+
+	return 0;
+}
+
+/* same weights as ConvertToGray() in tocnpwg */
+static unsigned char RGBToGray( const unsigned char *rgb )
+{
+	return (unsigned char)(((2126 * rgb[0]) + (7152 * rgb[1]) + (722 * rgb[2]))/10000);
+}
+
+/*
+ * Write one line group, the encoding of cups_raster_write() for 1 byte pixels.
+ */
+static int WriteGrayLine( PWGGRAY_SINK *sink, const unsigned char *pixels, long width, int count, unsigned char *work )
+{
+	const unsigned char *start, *ptr, *pend, *plast;
+	unsigned char *wptr = work;
+	int n;
+
+	pend  = pixels + width;
+	plast = pend - 1;
+	*wptr++ = count - 1;
+
+	for ( ptr = pixels; ptr < pend; ) {
+		start = ptr;
+		ptr++;
+
+		if ( ptr == pend ) {
+			/* single pixel at the end */
+			*wptr++ = 0;
+			*wptr++ = *start;
+		}
+		else if ( *start == *ptr ) {
+			/* repeating pixels */
+			for ( n = 2; n < PWG_RUN_MAX && ptr < plast; n++, ptr++ ) {
+				if ( ptr[0] != ptr[1] ) break;
+			}
+			*wptr++ = n - 1;
+			*wptr++ = *ptr++;
+		}
+		else {
+			/* non-repeating pixels */
+			for ( n = 1; n < PWG_RUN_MAX && ptr < plast; n++, ptr++ ) {
+				if ( ptr[0] == ptr[1] ) break;
+			}
+			if ( ptr >= plast && n < PWG_RUN_MAX ) {
+				n++;
+				ptr++;
+			}
+			*wptr++ = 257 - n;
+			memcpy( wptr, start, n );
+			wptr += n;
+		}
+	}
+
+	return SinkWrite( sink, work, wptr - work );
+}
+
+/*
+ * Decode one sRGB line straight into gray, one conversion per run.
+ */
+static long DecodeRGBLineToGray( const unsigned char *src, long srcSize, unsigned char *gray, long width )
+{
+	const unsigned char *ptr = src;
+	const unsigned char *end = src + srcSize;
+	long x = 0;
+	int n;
+
+	while ( x < width ) {
+		if ( ptr >= end ) return -1;
+		n = *ptr++;
+
+		if ( n & 0x80 ) {
+			/* literal pixels */
+			n = 257 - n;
+			if ( (x + n > width) || (ptr + n * RGB_COMPONENT > end) ) return -1;
+			for ( ; n > 0; n--, ptr += RGB_COMPONENT ) {
+				gray[x++] = RGBToGray( ptr );
+			}
+		}
+		else {
+			/* repeated pixel */
+			n = n + 1;
+			if ( (x + n > width) || (ptr + RGB_COMPONENT > end) ) return -1;
+			memset( gray + x, RGBToGray( ptr ), n );
+			x += n;
+			ptr += RGB_COMPONENT;
+		}
+	}
+
+	return ptr - src;
+}
+
+long PwgGrayTranscode( const unsigned char *src, long srcSize, int out_fd, unsigned char *outBuf, long outBufSize )
+{
+	PWGGRAY_SINK sink;
+	unsigned char header[PWG_HEADER_SIZE];
+	unsigned char *grayLine = NULL;
+	unsigned char *prevLine = NULL;
+	unsigned char *work = NULL;
+	const unsigned char *ptr, *end;
+	long width, height, lines, used;
+	int repeat, count, n;
+	long result = -1;
+
+	if ( srcSize < PWG_SYNC_SIZE + PWG_HEADER_SIZE ) goto onErr;
+
+	memcpy( header, src + PWG_SYNC_SIZE, PWG_HEADER_SIZE );
+	width = GetHeaderValue( header, PWG_HEADER_WIDTH );
+	height = GetHeaderValue( header, PWG_HEADER_HEIGHT );
+
+	if ( (GetHeaderValue( header, PWG_HEADER_COLORSPACE ) != PWG_CSPACE_SRGB) ||
+		 (GetHeaderValue( header, PWG_HEADER_BITSPERPIXEL ) != 8 * RGB_COMPONENT) ||
+		 (width <= 0) ) {
+		DEBUG_PRINT( "DEBUG:[tocanonij] PwgGrayTranscode unsupported page\n" );
+		goto onErr;
+	}
+
+	/* same header changes as pwgRasterUpdate() for the gray stream */
+	SetHeaderValue( header, PWG_HEADER_NUMCOLORS, 1 );
+	SetHeaderValue( header, PWG_HEADER_BITSPERPIXEL, 8 );
+	SetHeaderValue( header, PWG_HEADER_BYTESPERLINE, width );
+	SetHeaderValue( header, PWG_HEADER_COLORSPACE, PWG_CSPACE_SGRAY );
+
+	if ( (grayLine = malloc( width )) == NULL ) goto onErr;
+	if ( (prevLine = malloc( width )) == NULL ) goto onErr;
+	if ( (work = malloc( width * 2 + 1 )) == NULL ) goto onErr;
+
+	memset( &sink, 0, sizeof(sink) );
+	sink.fd = out_fd;
+	sink.buf = outBuf;
+	sink.bufSize = outBufSize;
+
+	if ( SinkWrite( &sink, src, PWG_SYNC_SIZE ) != 0 ) goto onErr;
+	if ( SinkWrite( &sink, header, PWG_HEADER_SIZE ) != 0 ) goto onErr;
+
+	ptr = src + PWG_SYNC_SIZE + PWG_HEADER_SIZE;
+	end = src + srcSize;
+	count = 0;
+
+	for ( lines = 0; lines < height; ) {
+		if ( ptr >= end ) goto onErr;
+		repeat = *ptr++ + 1;
+		lines += repeat;
+
+		if ( (used = DecodeRGBLineToGray( ptr, end - ptr, grayLine, width )) < 0 ) goto onErr;
+		ptr += used;
+
+		/* different RGB lines may give the same gray line */
+		if ( (count > 0) && memcmp( grayLine, prevLine, width ) ) {
+			if ( WriteGrayLine( &sink, prevLine, width, count, work ) != 0 ) goto onErr;
+			count = 0;
+		}
+
+		while ( repeat > 0 ) {
+			if ( count == 0 ) {
+				memcpy( prevLine, grayLine, width );
+				count = 1;
+				repeat--;
+				continue;
+			}
+
+			n = PWG_LINE_REPEAT_MAX - count;
+			if ( n > repeat ) n = repeat;
+			count += n;
+			repeat -= n;
+
+			if ( count == PWG_LINE_REPEAT_MAX ) {
+				if ( WriteGrayLine( &sink, prevLine, width, count, work ) != 0 ) goto onErr;
+				count = 0;
+			}
+		}
+	}
+
+	if ( count > 0 ) {
+		if ( WriteGrayLine( &sink, prevLine, width, count, work ) != 0 ) goto onErr;
+	}
+	if ( (out_fd != -1) && (SinkFlush( &sink ) != 0) ) goto onErr;
+
+	result = sink.total;
+onErr:
+	if ( work != NULL ) free( work );
+	if ( prevLine != NULL ) free( prevLine );
+	if ( grayLine != NULL ) free( grayLine );
+	return result;
+}
@@ -0,0 +1,51 @@
+/*
+ *  Canon Inkjet Printer Driver for Linux
+ *  Copyright CANON INC. 2001-2024
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
+ *
+ * NOTE:
+ *  - As a special exception, this program is permissible to link with the
+ *    libraries released as the binary modules.
+ *  - If you write modifications of your own for these programs, it is your
+ *    choice whether to permit this exception to apply to your modifications.
+ *    If you do not wish that, delete this exception.
+*/
+
+#ifndef _PWGGRAY_H_
+#define _PWGGRAY_H_
+
+/* PWG raster stream layout (network byte order) */
+#define PWG_SYNC_SIZE				(4)
+#define PWG_HEADER_SIZE				(1796)
+#define PWG_HEADER_WIDTH			(372)
+#define PWG_HEADER_HEIGHT			(376)
+#define PWG_HEADER_BITSPERCOLOR		(384)
+#define PWG_HEADER_BITSPERPIXEL		(388)
+#define PWG_HEADER_BYTESPERLINE		(392)
+#define PWG_HEADER_COLORSPACE		(400)
+#define PWG_HEADER_NUMCOLORS		(420)
+
+#define PWG_CSPACE_SGRAY			(18)
+#define PWG_CSPACE_SRGB				(19)
+
+/*
+ * Convert one 8bit sRGB PWG page (sync word, header and PackBits data)
+ * into the 8bit sGray page tocnpwg would have produced for it.
+ * The result is written to out_fd through outBuf, or only measured
+ * when out_fd is -1. Returns the size of the gray page, -1 on error.
+ */
+long PwgGrayTranscode( const unsigned char *src, long srcSize, int out_fd, unsigned char *outBuf, long outBufSize );
+
+#endif
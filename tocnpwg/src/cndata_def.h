@@ -16,8 +16,14 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307, USA.
 */
 
+#include <stdint.h>
+
 #define MAGIC_NUMBER_FOR_CNIJPWG	0x12340001
 #define MAGIC_NUMBER_FOR_CNIJJPEG	0x12340002
+#define MAGIC_NUMBER_FOR_CNIJPWG2	0x12340003
+
+/* chunk_flags, --bandlines only */
+#define CNDATA_CHUNK_MORE	0x0001
 
 enum ColorMode{
 	COLOR_MODE_UNKNOWN = 0,
@@ -32,5 +38,28 @@ typedef struct cndata {
 	short	page_num;
 	enum ColorMode	jobColorMode;
 	enum ColorMode	pageColorMode;
-	long	reserve[13];
+	long	chunk_flags;		/* CNDATA_CHUNK_MORE while the page goes on in the next record */
+	long	reserve[12];
 } CNDATA, *LPCNDATA;
+
+/* CNDATA2 flags */
+#define CNDATA2_FLAG_LAST_PAGE		0x0001	/* no page follows this one */
+#define CNDATA2_FLAG_CHUNK_MORE		0x0002	/* the page goes on in the next record, LAST_PAGE only counts on the last record */
+#define CNDATA2_FLAG_VERDICT_MASK	0x0030	/* reserved for a per-page color verdict, never set, readers ignore it */
+
+/*
+ * Page record version 2, laid out the same on 32 and 64 bit builds.
+ * The first 32 bits hold the magic number in both versions (little endian),
+ * so a reader tells CNDATA and CNDATA2 apart by them.
+ */
+typedef struct cndata2 {
+	uint32_t	magic_num;		/* MAGIC_NUMBER_FOR_CNIJPWG2 */
+	uint32_t	record_size;	/* sizeof(CNDATA2), later versions may append fields */
+	uint64_t	image_size;
+	uint32_t	page_seq;		/* page sequence number, from 1 */
+	uint32_t	chunk_index;	/* record of the page, from 0 */
+	uint32_t	flags;			/* CNDATA2_FLAG_XXX */
+	uint16_t	jobColorMode;	/* enum ColorMode */
+	uint16_t	pageColorMode;	/* enum ColorMode */
+	uint32_t	reserve[8];
+} CNDATA2, *LPCNDATA2;
@@ -84,7 +84,8 @@ enum {
 	OPT_DUPLEXPRINT,
 	OPT_COLORMODE,
 	OPT_ROTATE180,
-	OPT_OPTIMIZATION
+	OPT_OPTIMIZATION,
+	OPT_BANDLINES
 };
 
 static char *StringToLower ( char *src ) 
@@ -121,6 +122,7 @@ typedef struct					/**** Raster stream data ****/
 //						*bufend;	/* End of current (read) buffer */
 	size_t		bufsize;	/* Buffer size */
 	enum ColorMode	pageColorMode;	/* Page color mode */
+	unsigned	inColors;	/* Colors per pixel of the lines handed in */
 } pwg_raster_s;
 
 typedef struct					/**** Raster stream data ****/
@@ -128,6 +130,10 @@ typedef struct					/**** Raster stream data ****/
 	pwg_raster_s        pwgRasterList[COLOR_MODE_COUNT];
 	short 				optimization;		/* The method to check color */
 	enum ColorMode 		*jobColorMode;			/* Job color mode */
+	long				bandLines;			/* Lines per chunk record, 0 outputs the whole page */
+	long				bandCount;			/* Lines written since the last chunk record */
+	long				bandPage;			/* page_seq of the chunk records */
+	uint32_t			bandIndex;			/* chunk_index of the next record */
 } pwg_raster_data;
 
 typedef struct SizePixelTable {
@@ -144,6 +150,7 @@ static void pwgRasterUpdate( pwg_raster_s *r);
 static unsigned pwgRasterWriteHeaderByColorMode( pwg_raster_s *r, cups_page_header2_t *h );
 static unsigned pwgRasterWriteHeader( pwg_raster_data *r, cups_page_header2_t *h );
 static void ConvertToGray(unsigned char *src, int buffSize, unsigned char *dst);
+static void ExpandGray(unsigned char *src, int buffSize, unsigned char *dst);
 static int pwgRasterWritePixelsByLine( pwg_raster_data *r, unsigned char *p);
 static int ComputeDestinationSize( long in_w, long in_h, long out_w, long out_h, long *dst_w, long *dst_h, long *ofs_w, long *ofs_h );
 static int h_extend( unsigned char *in, unsigned char *out, int src_width, int dst_width, int component );
@@ -152,20 +159,21 @@ static short mirror_raster( unsigned char *buf, long width, short bpp );
 static int rawRasterTempOpen( void );
 static int InitPWGPageData( pwg_raster_data **outras, short optimization, enum ColorMode *jobColorMode, short isMonoChrome );
 static int CreatePWGPageData( int page, cups_page_header2_t *inheader, cups_raster_t *inras, pwg_raster_data *outras, long printable_width, long printable_height, int is_rotate );
-static int OutputPWGPageDataByColor( pwg_raster_s *outras, short isNextPage, short page, enum ColorMode jobColorMode );
-static int OutputPWGPageData( pwg_raster_data *outras, short isNextPage, short page );
+static int OutputPWGPageDataByColor( pwg_raster_s *outras, short isNextPage, long page, uint32_t chunkIndex, enum ColorMode jobColorMode, uint32_t chunkFlags );
+static int OutputPWGPageData( pwg_raster_data *outras, short isNextPage, long page );
+static int OutputPWGBandData( pwg_raster_data *outras );
 static int DestroyPWGPageData( pwg_raster_data **outras );
 static int isRotate( const char *option );
 static void SetJobColorMode( unsigned char *in, int width, pwg_raster_data *outras );
 
-static long GetFileSize( int fd )
+static int64_t GetFileSize( int fd )
 {
 	struct stat buf;
-	long result = -1;
+	int64_t result = -1;
 
 	fstat( fd, &buf );
 	result = buf.st_size;
-	DEBUG_PRINT2( "DEBUG:[tocnpwg] PWGRaster File Size: %ld\n",result );
+	DEBUG_PRINT2( "DEBUG:[tocnpwg] PWGRaster File Size: %lld\n", (long long)result );
 
 	return result;
 }
@@ -280,14 +288,9 @@ static int pwgRasterInit(
 			pwgRasterTempOpen(&((*r)->pwgRasterList[listIndex]), COLOR_MODE_GRAY);
 		}
 		else{
+			/* only the color page is sent, tocanonij converts it when the job stays gray */
 			DEBUG_PRINT( "DEBUG:[tocnpwg] Create 3-channel data\n" );
 			pwgRasterTempOpen(&((*r)->pwgRasterList[listIndex]), COLOR_MODE_COLOR);
-			listIndex++;
-
-			if(*jobColorMode == COLOR_MODE_GRAY){
-				DEBUG_PRINT( "DEBUG:[tocnpwg] Create 1-channel data\n" );
-				pwgRasterTempOpen(&((*r)->pwgRasterList[listIndex]), COLOR_MODE_GRAY);
-			}
 		}
 	}
 
@@ -337,7 +340,7 @@ onErr:
 /*
  * for GetFileSize
  */
-static long pwgRasterGetFileSize( pwg_raster_s *r )
+static int64_t pwgRasterGetFileSize( pwg_raster_s *r )
 {
 	return ( GetFileSize((int)r->ctx) );
 }
@@ -359,6 +362,12 @@ static void pwgRasterUpdate(
 {
 
 	if(r->pageColorMode == COLOR_MODE_COLOR){
+		if(r->inColors == 1){
+			/* gray input goes out as sRGB */
+			r->header.cupsNumColors = COLOR_COMPONENT;
+			r->header.cupsBitsPerPixel = 8 * COLOR_COMPONENT;
+			r->header.cupsBytesPerLine = r->header.cupsWidth * COLOR_COMPONENT;
+		}
 		r->header.cupsColorSpace = 19;
 	} else if(r->pageColorMode == COLOR_MODE_GRAY) {
 		r->header.cupsNumColors = 1;
@@ -414,6 +423,7 @@ static unsigned pwgRasterWriteHeaderByColorMode(
 	if ( r == NULL ) goto onErr;
 
   	memcpy(&(r->header), h, sizeof(cups_page_header2_t));
+	r->inColors = h->cupsNumColors;
 
 	pwgRasterUpdate(r);
 
@@ -720,6 +730,14 @@ static void ConvertToGray(unsigned char *src, int buffSize, unsigned char *dst)
 	}
 }
 
+/* gray pixels to sRGB, buffSize is the number of pixels */
+static void ExpandGray(unsigned char *src, int buffSize, unsigned char *dst)
+{
+	for(int i = 0 ; i < buffSize ; i++, dst += 3) {
+		dst[0] = dst[1] = dst[2] = src[i];
+	}
+}
+
 static unsigned int pwgRasterWritePixelsDataByColorMode(
 	pwg_raster_s *r,		/* I - Raster stream */
 	unsigned char *p,		/* I - Bytes to write */
@@ -727,7 +745,22 @@ static unsigned int pwgRasterWritePixelsDataByColorMode(
 {
 	unsigned result = 0;
 
-	if(r->pageColorMode == COLOR_MODE_COLOR) {
+	if(r->inColors == 1) {
+		/* 1-channel input is already gray */
+		if(r->pageColorMode == COLOR_MODE_COLOR) {
+			unsigned char *dst;
+
+			if ( (dst = malloc(len)) == NULL ){
+				return result;
+			}
+			ExpandGray(p, len / COLOR_COMPONENT, dst);
+			result = pwgRasterWritePixels(r, dst, len);
+
+			free(dst);
+		} else if(r->pageColorMode == COLOR_MODE_GRAY) {
+			result = pwgRasterWritePixels(r, p, len);
+		}
+	} else if(r->pageColorMode == COLOR_MODE_COLOR) {
 		result = pwgRasterWritePixels(r, p, len);
 	} else if(r->pageColorMode == COLOR_MODE_GRAY) {
 		unsigned char *dst;
@@ -757,6 +790,14 @@ pwgRasterWritePixelsByLine(
 		}
 	}
 
+	/* hand the finished band to tocanonij while the rest of the page is rendered */
+	if(r->bandLines > 0 && ++(r->bandCount) >= r->bandLines){
+		r->bandCount = 0;
+		if(OutputPWGBandData(r) != 0){
+			return -1;
+		}
+	}
+
 	return 0;
 }
 
@@ -781,6 +822,7 @@ int main( int argc, char *argv[] )
 		{ "grayscale", required_argument, NULL, OPT_COLORMODE }, 
 		{ "rotate180", required_argument, NULL, OPT_ROTATE180 },
 		{ "optimization", required_argument, NULL, OPT_OPTIMIZATION},
+		{ "bandlines", required_argument, NULL, OPT_BANDLINES},
 		{ 0, 0, 0, 0 }, 
 	};
 	int isPWGExist;
@@ -788,6 +830,7 @@ int main( int argc, char *argv[] )
 
 	short isMonoChrome = 0;
 	short optimization = 0;
+	long bandLines = 0;
 	enum ColorMode jobColorMode = COLOR_MODE_GRAY;
 
 	printable_width = printable_height = 0;
@@ -831,6 +874,10 @@ int main( int argc, char *argv[] )
 					optimization = 1;
 				}
 				break;
+			case OPT_BANDLINES:
+				DEBUG_PRINT3( "[tocnpwg] OPTION(%s):VALUE(%s)\n", long_opt[opt_index].name, optarg );
+				bandLines = atol( optarg );
+				break;
 		}
 	}
 	
@@ -848,7 +895,7 @@ int main( int argc, char *argv[] )
 
 		/* exist next page */
 		if ( isPWGExist ) {
-			if ( OutputPWGPageData( outras, 1, page) != 0 ) goto onErr;
+			if ( OutputPWGPageData( outras, 1, page - 1 ) != 0 ) goto onErr;
 			DestroyPWGPageData( &outras );
 			isPWGExist = 0;
 		}
@@ -861,6 +908,15 @@ int main( int argc, char *argv[] )
 		}
 
 		InitPWGPageData( &outras, optimization, &jobColorMode, isMonoChrome );
+
+		/*
+		 * Chunk records say nothing about the next page, it is only known once
+		 * the next header is read. --optimization needs the whole page.
+		 */
+		if ( bandLines > 0 && optimization == 0 ) {
+			outras->bandLines = bandLines;
+			outras->bandPage = page;
+		}
 		if ( CreatePWGPageData( page, &inheader, inras, outras, printable_width, printable_height, is_rotate ) != 0 ) goto onErr;
 		isPWGExist = 1;
 
@@ -869,7 +925,7 @@ int main( int argc, char *argv[] )
 
 	/* not exist next page */
 	if ( isPWGExist ) {
-		if ( OutputPWGPageData( outras, 0, page) != 0 ) goto onErr;
+		if ( OutputPWGPageData( outras, 0, page - 1 ) != 0 ) goto onErr;
 		DestroyPWGPageData( &outras );
 		isPWGExist = 0;
 	}
@@ -942,6 +998,11 @@ static int h_extend( unsigned char *in, unsigned char *out, int src_width, int d
 	if ( dst_width == 0 ) {
 		goto EXIT;
 	}
+	else if ( dst_width == src_width ) {
+		/* rendered at the print area size, nothing to resample */
+		memcpy( out, in, dst_width * component );
+		goto EXIT;
+	}
 	else if ( dst_width == 1 ){
 		switch ( component ){
 			case 1:
@@ -1104,38 +1165,49 @@ onErr:
 	return result;
 }
 
-static int OutputPWGPageDataByColor( pwg_raster_s *outras, short isNextPage, short page, enum ColorMode jobColorMode )
+static int OutputPWGPageDataByColor( pwg_raster_s *outras, short isNextPage, long page, uint32_t chunkIndex, enum ColorMode jobColorMode, uint32_t chunkFlags )
 {
 	int result = -1;
-	CNDATA CNData;
+	CNDATA2 CNData;
 
 	if ( outras == NULL )  goto onErr;
 
 	/* Write Page Info */
-   	memset( &CNData, 0x00, sizeof(CNDATA) );
-	CNData.magic_num = MAGIC_NUMBER_FOR_CNIJPWG;
+   	memset( &CNData, 0x00, sizeof(CNDATA2) );
+	CNData.magic_num = MAGIC_NUMBER_FOR_CNIJPWG2;
+	CNData.record_size = sizeof(CNDATA2);
 	CNData.image_size = pwgRasterGetFileSize(outras);
-	CNData.next_page = isNextPage;
-	CNData.page_num = page;
+	CNData.page_seq = page;
+	CNData.chunk_index = chunkIndex;
+	CNData.flags = chunkFlags;
+	if ( !isNextPage ) {
+		CNData.flags |= CNDATA2_FLAG_LAST_PAGE;
+	}
 	CNData.jobColorMode = jobColorMode;
 	CNData.pageColorMode = outras->pageColorMode;
 
-	write( 1, &CNData, sizeof(CNDATA) );
+	write( 1, &CNData, sizeof(CNDATA2) );
 
 	/* Output PWG Page Data */
 	pwgRasterDump(outras);
 
+	if ( chunkFlags & CNDATA2_FLAG_CHUNK_MORE ) {
+		/* the next chunk starts with the following bytes of the page */
+		if ( ftruncate( (int)outras->ctx, 0 ) != 0 ) goto onErr;
+		lseek( (int)outras->ctx, 0, SEEK_SET );
+	}
+
 	result = 0;
 onErr:
 	return result;
 }
 
-static int OutputPWGPageData( pwg_raster_data *outras, short isNextPage, short page )
+static int OutputPWGPageData( pwg_raster_data *outras, short isNextPage, long page )
 {
 	for(int i = 0; i < COLOR_MODE_COUNT; i++){
 		if(outras->pwgRasterList[i].pageColorMode != COLOR_MODE_UNKNOWN){
 			DEBUG_PRINT2( "DEBUG:[tocnpwg] Output Page ColorMode: %d\n", outras->pwgRasterList[i].pageColorMode);
-			if(OutputPWGPageDataByColor(&(outras->pwgRasterList[i]), isNextPage, page, *(outras->jobColorMode)) != 0 ){
+			if(OutputPWGPageDataByColor(&(outras->pwgRasterList[i]), isNextPage, page, outras->bandIndex, *(outras->jobColorMode), 0) != 0 ){
 				return -1;
 			}
 		}
@@ -1143,6 +1215,32 @@ static int OutputPWGPageData( pwg_raster_data *outras, short isNextPage, short p
 	return 0;
 }
 
+/*
+ * output the data written so far as a chunk record, the last chunk is left
+ * to OutputPWGPageData which also tells whether another page follows
+ */
+static int OutputPWGBandData( pwg_raster_data *outras )
+{
+	int written = 0;
+
+	for(int i = 0; i < COLOR_MODE_COUNT; i++){
+		if(outras->pwgRasterList[i].pageColorMode != COLOR_MODE_UNKNOWN){
+			/* rows held back as a repeat count are not in the file yet */
+			if(pwgRasterGetFileSize(&(outras->pwgRasterList[i])) <= 0){
+				continue;
+			}
+			if(OutputPWGPageDataByColor(&(outras->pwgRasterList[i]), 1, outras->bandPage, outras->bandIndex, *(outras->jobColorMode), CNDATA2_FLAG_CHUNK_MORE) != 0 ){
+				return -1;
+			}
+			written = 1;
+		}
+	}
+	if(written){
+		outras->bandIndex++;
+	}
+	return 0;
+}
+
 static int DestroyPWGPageData( pwg_raster_data **outras )
 {
 	int result = -1;
@@ -1212,6 +1310,7 @@ static int CreatePWGPageData(
 	switch (inheader->cupsColorSpace)
 	{
 		case CUPS_CSPACE_W :
+		case CUPS_CSPACE_SW :	/* CNGrayscale asks for 8bit sGray */
 		case CUPS_CSPACE_RGB :
 			white = 255;
 			break;
@@ -1273,6 +1372,10 @@ static int CreatePWGPageData(
 	DEBUG_PRINT2( "DEBUG:[tocnpwg] dst_h: %ld\n",dst_h );
 	DEBUG_PRINT2( "DEBUG:[tocnpwg] ofs_w: %ld\n",ofs_w );
 	DEBUG_PRINT2( "DEBUG:[tocnpwg] ofs_h: %ld\n",ofs_h );
+	if ( (in_w != out_w) || (in_h != out_h) ) {
+		/* ppd/checkprintarea.pl lists the sizes that end up here */
+		DEBUG_PRINT( "DEBUG:[tocnpwg] resample to the print area\n" );
+	}
 
 
 	// ############################################### update outheader
@@ -1357,8 +1460,10 @@ static int CreatePWGPageData(
 				}
 			}
 			
-			/* clear output buffer */	
-			memset(out_ptr, white, out_buf_size);
+			/* clear output buffer, unless the line fills it */
+			if ( dst_w != out_w ) {
+				memset(out_ptr, white, out_buf_size);
+			}
 
 			/* resize output data */
 			if ( h_extend( in_ptr, out_ptr + ofs_w * outheader.cupsNumColors, in_w, dst_w, outheader.cupsNumColors ) != 0 ) goto onErr3;
@@ -1427,8 +1532,10 @@ static int CreatePWGPageData(
 				}
 			}
 			
-			/* clear output buffer */	
-			memset(out_ptr, white, out_buf_size);
+			/* clear output buffer, unless the line fills it */
+			if ( dst_w != out_w ) {
+				memset(out_ptr, white, out_buf_size);
+			}
 
 			/* resize output data */
 			if ( h_extend( in_ptr, out_ptr + ofs_w * outheader.cupsNumColors, in_w, dst_w, outheader.cupsNumColors ) != 0 )  goto onErr3;